@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "allocation.h"
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+using namespace std;
+
+AllocationProfile *AllocationProfile::active = nullptr;
+
+AllocationProfile::AllocationProfile()
+{
+    this->rules.resize(14);
+}
+
+vector<string> &AllocationProfile::getTypeNames()
+{
+    static vector<string> names;
+    return names;
+}
+
+int AllocationProfile::registerType(const char *name)
+{
+    string readable = name;
+#ifdef __GNUG__
+    int status;
+    char *demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+    if (status == 0)
+        readable = demangled;
+    free(demangled);
+#endif
+
+    getTypeNames().push_back(readable);
+    return getTypeNames().size() - 1;
+}
+
+void AllocationProfile::allocated(int type, size_t bytes)
+{
+    if (type >= (int)types.size())
+    {
+        types.resize(type + 1);
+        pending.resize(type + 1);
+    }
+
+    TypeCount &count = types[type];
+    ++count.total.nodes;
+    count.total.bytes += bytes;
+    count.peakLive = max(count.peakLive, ++count.live);
+
+    if (pending[type].nodes == 0)
+        touched.push_back(type);
+    ++pending[type].nodes;
+    pending[type].bytes += bytes;
+
+    ++live;
+    liveBytes += bytes;
+    if (live > peakLive)
+    {
+        peakLive = live;
+        peakLiveBytes = liveBytes;
+    }
+}
+
+void AllocationProfile::released(int type, size_t bytes)
+{
+    // Nodes created before the profile was active are not counted
+    if (type >= (int)types.size() || types[type].live == 0)
+        return;
+
+    --types[type].live;
+    --live;
+    liveBytes -= bytes;
+}
+
+void AllocationProfile::attribute(int rule)
+{
+    vector<Count> &counts = rules[rule];
+    for (int type : touched)
+    {
+        if (type >= (int)counts.size())
+            counts.resize(type + 1);
+        counts[type].nodes += pending[type].nodes;
+        counts[type].bytes += pending[type].bytes;
+        pending[type] = Count();
+    }
+    touched.clear();
+}
+
+void AllocationProfile::print(ostream &os)
+{
+    attribute(0);
+    const vector<string> &names = getTypeNames();
+
+    long nodes = 0, bytes = 0;
+    vector<int> order;
+    for (int type = 0; type < (int)types.size(); ++type)
+    {
+        nodes += types[type].total.nodes;
+        bytes += types[type].total.bytes;
+        if (types[type].total.nodes > 0)
+            order.push_back(type);
+    }
+    sort(order.begin(), order.end(), [this](int a, int b)
+         { return types[a].total.bytes > types[b].total.bytes; });
+
+    os << "Allocations: " << nodes << " nodes, " << bytes << " bytes\n";
+    os << "Live at most: " << peakLive << " nodes, " << peakLiveBytes << " bytes\n\n";
+
+    os << setw(18) << "Type" << setw(12) << "Nodes" << setw(14) << "Bytes" << setw(12) << "Peak live" << "\n";
+    for (int type : order)
+    {
+        os << setw(18) << names[type] << setw(12) << types[type].total.nodes << setw(14) << types[type].total.bytes
+           << setw(12) << types[type].peakLive << "\n";
+    }
+
+    os << "\n";
+    for (int rule = 0; rule < (int)rules.size(); ++rule)
+    {
+        long ruleNodes = 0, ruleBytes = 0;
+        vector<pair<long, int>> ruleTypes;
+        for (int type = 0; type < (int)rules[rule].size(); ++type)
+        {
+            ruleNodes += rules[rule][type].nodes;
+            ruleBytes += rules[rule][type].bytes;
+            if (rules[rule][type].nodes > 0)
+                ruleTypes.push_back({-rules[rule][type].nodes, type});
+        }
+        if (ruleNodes == 0)
+            continue;
+
+        sort(ruleTypes.begin(), ruleTypes.end());
+        os << (rule == 0 ? string("Outside execution") : "Rule " + to_string(rule)) << ": " << ruleNodes << " nodes, " << ruleBytes
+           << " bytes (";
+        for (int i = 0; i < (int)ruleTypes.size(); ++i)
+        {
+            os << (i == 0 ? "" : ", ") << names[ruleTypes[i].second] << " " << -ruleTypes[i].first;
+        }
+        os << ")\n";
+    }
+}
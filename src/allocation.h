@@ -0,0 +1,176 @@
+#ifndef ALLOCATION_H
+#define ALLOCATION_H
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+/**
+ * Counts the nodes created through makeNode while it is active: the number and the bytes of the allocations of each
+ * node type, the CSE rule of the step that allocated them and the highest number of nodes alive at once. The bytes
+ * include the reference count that is allocated with each node.
+ */
+class AllocationProfile
+{
+public:
+    static AllocationProfile *active; // the profile counting the allocations, nullptr if none
+
+    AllocationProfile();
+
+    /**
+     * @brief Get the index of a node type, registering it on first use
+     * @param name The mangled name of the type
+     * @return The index
+     */
+    static int registerType(const char *name);
+
+    /**
+     * @brief Count an allocation
+     * @param type The index of the node type
+     * @param bytes The size of the allocation
+     */
+    void allocated(int type, std::size_t bytes);
+
+    /**
+     * @brief Count a deallocation
+     * @param type The index of the node type
+     * @param bytes The size of the allocation
+     */
+    void released(int type, std::size_t bytes);
+
+    /**
+     * @brief Attribute the allocations since the last call to a CSE rule
+     * @param rule The rule, 0 for the allocations outside the execution
+     */
+    void attribute(int rule);
+
+    /**
+     * @brief Get the number of nodes of a type alive now
+     * @param type The index of the node type
+     * @return The number of nodes
+     */
+    long getLive(int type) const
+    {
+        return type < (int)types.size() ? types[type].live : 0;
+    }
+
+    /**
+     * @brief Get the bytes of the nodes alive now
+     * @return The bytes
+     */
+    long getLiveBytes() const
+    {
+        return liveBytes;
+    }
+
+    /**
+     * @brief Print the counts
+     * @param os The output stream to write to
+     */
+    void print(std::ostream &os);
+
+private:
+    struct Count
+    {
+        long nodes = 0;
+        long bytes = 0;
+    };
+
+    struct TypeCount
+    {
+        Count total;
+        long live = 0;     // nodes alive now
+        long peakLive = 0; // most nodes alive at once
+    };
+
+    std::vector<TypeCount> types;            // counts of each node type
+    std::vector<std::vector<Count>> rules;   // counts of each node type allocated by each rule; rule 0 is outside the execution
+    std::vector<Count> pending;              // counts of each node type not attributed to a rule yet
+    std::vector<int> touched;                // node types with pending counts
+    long live = 0;                           // nodes alive now
+    long liveBytes = 0;                      // bytes of the nodes alive now
+    long peakLive = 0;                       // most nodes alive at once
+    long peakLiveBytes = 0;                  // bytes of the nodes alive at the peak
+
+    /**
+     * @brief Get the names of the registered node types
+     * @return The names, by index
+     */
+    static std::vector<std::string> &getTypeNames();
+};
+
+/**
+ * @brief Get the index of a node type in the allocation profile
+ * @return The index
+ */
+template <typename T>
+int getNodeType()
+{
+    static const int type = AllocationProfile::registerType(typeid(T).name());
+    return type;
+}
+
+// Allocates the nodes of type Node created by makeNode, counting them in the active allocation profile; the allocator is
+// stateless so that it takes no space next to the reference count
+template <typename T, typename Node>
+class NodeAllocator
+{
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind
+    {
+        using other = NodeAllocator<U, Node>;
+    };
+
+    NodeAllocator() = default;
+
+    template <typename U>
+    NodeAllocator(const NodeAllocator<U, Node> &)
+    {
+    }
+
+    T *allocate(std::size_t n)
+    {
+        if (AllocationProfile::active != nullptr)
+            AllocationProfile::active->allocated(getNodeType<Node>(), n * sizeof(T));
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, std::size_t n)
+    {
+        if (AllocationProfile::active != nullptr)
+            AllocationProfile::active->released(getNodeType<Node>(), n * sizeof(T));
+        ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const NodeAllocator<U, Node> &) const
+    {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const NodeAllocator<U, Node> &) const
+    {
+        return false;
+    }
+};
+
+/**
+ * @brief Create a node; all the nodes of the trees and the values of the machine are created here
+ * @param args The arguments of the constructor
+ * @return The node
+ */
+template <typename T, typename... Args>
+std::shared_ptr<T> makeNode(Args &&...args)
+{
+    return std::allocate_shared<T>(NodeAllocator<T, T>(), std::forward<Args>(args)...);
+}
+
+#endif // ALLOCATION_H
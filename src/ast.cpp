@@ -1,17 +1,14 @@
+#include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <string_view>
 #include <utility>
 #include <vector>
 #include "ast.h"
 
 using namespace std;
 
-/**
- * @brief Return the level of a token from the number of preceding dots
- * @param str The token to check
- * @return The level of the token
- */
-int getLevel(string str)
+int getLevel(string_view str)
 {
     int level = 0;
     for (int i = 0; i < (int)str.length(); i++)
@@ -28,28 +25,22 @@ int getLevel(string str)
     return level;
 }
 
-/**
- * @brief Get the type of a token
- * @param str The token to check
- * @param level The level of the token
- * @return A pair of type and value
- */
-pair<Type, string> getType(string str, int level)
+pair<Type, string_view> getType(string_view str, int level)
 {
     str = str.substr(level, str.length() - level);
     if (str.rfind("<ID:", level - 1) == 0)
     {
-        string identifier = str.substr(4, str.length() - 5);
+        string_view identifier = str.substr(4, str.length() - 5);
         return make_pair(IDENTIFIER, identifier);
     }
     else if (str.rfind("<INT:", level - 1) == 0)
     {
-        string integer = str.substr(5, str.length() - 6);
+        string_view integer = str.substr(5, str.length() - 6);
         return make_pair(INTEGER, integer);
     }
     else if (str.rfind("<STR:", level - 1) == 0)
     {
-        string _string = str.substr(6, str.length() - 8);
+        string_view _string = str.substr(6, str.length() - 8);
         return make_pair(STRING, _string);
     }
     else
@@ -58,6 +49,25 @@ pair<Type, string> getType(string str, int level)
     }
 }
 
+ASTNode::~ASTNode()
+{
+    // Take the children of the nodes held only by this subtree out before destroying them, so deep trees do not recurse
+    vector<shared_ptr<ASTNode>> pending = move(children);
+    while (!pending.empty())
+    {
+        shared_ptr<ASTNode> node = move(pending.back());
+        pending.pop_back();
+        if (node.use_count() == 1)
+        {
+            for (auto &child : node->children)
+            {
+                pending.push_back(move(child));
+            }
+            node->children.clear();
+        }
+    }
+}
+
 bool ASTNode::isLeaf() const
 {
     return children.size() == 0;
@@ -72,24 +82,24 @@ ostream &operator<<(ostream &os, const ASTNode &node)
 {
     if (node.type == IDENTIFIER)
     {
-        os << "<ID:" << node.value << ">";
+        os << "<ID:" << *node.value << ">";
     }
     else if (node.type == INTEGER)
     {
-        os << "<INT:" << node.value << ">";
+        os << "<INT:" << *node.value << ">";
     }
     else if (node.type == STRING)
     {
-        os << "<STR:'" << node.value << "'>";
+        os << "<STR:'" << *node.value << "'>";
     }
     else
     {
-        os << node.value;
+        os << *node.value;
     }
     return os;
 }
 
-shared_ptr<AST> AST::createAST(vector<string> tokens)
+shared_ptr<AST> AST::createAST(ASTReader &reader)
 {
     shared_ptr<AST> ast = make_shared<AST>();
 
@@ -99,9 +109,13 @@ shared_ptr<AST> AST::createAST(vector<string> tokens)
         return nullptr;
     }
 
+    StringTable strings;
     int currentLevel = 0;
     weak_ptr<ASTNode> currentParent = ast->root;
-    for (int i = 0; i < (int)tokens.size(); ++i)
+    int level;
+    Type type;
+    string_view value;
+    for (int i = 0; reader.next(level, type, value); ++i)
     {
         shared_ptr<ASTNode> node = make_shared<ASTNode>();
         node->parent = currentParent;
@@ -112,11 +126,8 @@ shared_ptr<AST> AST::createAST(vector<string> tokens)
             return nullptr;
         }
 
-        string token = tokens[i];
-        int level = getLevel(token);
-        auto type = getType(token, level);
-        node->type = type.first;
-        node->value = type.second;
+        node->type = type;
+        node->value = strings.intern(value); // the only copy of the value
 
         if (i == 0)
         {
@@ -128,7 +139,12 @@ shared_ptr<AST> AST::createAST(vector<string> tokens)
             continue;
         }
 
-        if (level == currentLevel + 1)
+        if (level > currentLevel + 1)
+        {
+            cerr << "Error: The AST skips a level\n";
+            exit(EXIT_FAILURE);
+        }
+        else if (level == currentLevel + 1)
         {
             // A child of the previous node
             currentLevel = level;
@@ -168,21 +184,30 @@ bool AST::isEmpty() const
 
 void AST::preOrder(shared_ptr<ASTNode> node, int level, ostream &os) const
 {
-    if (node == nullptr)
+    // An explicit stack of nodes and their depths, so the depth of the tree is not limited by the call stack
+    vector<pair<const ASTNode *, int>> pending;
+    if (node != nullptr)
     {
-        return;
+        pending.push_back({node.get(), level});
     }
 
-    for (int i = 0; i < level; i++)
+    while (!pending.empty())
     {
-        os << ".";
-    }
+        auto [current, depth] = pending.back();
+        pending.pop_back();
 
-    os << *node << "\n";
+        for (int i = 0; i < depth; i++)
+        {
+            os << ".";
+        }
 
-    for (int i = 0; i < (int)node->children.size(); i++)
-    {
-        preOrder(node->children[i], level + 1, os);
+        os << *current << "\n";
+
+        // Push in reverse so that the children come out in order
+        for (int i = (int)current->children.size() - 1; i >= 0; i--)
+        {
+            pending.push_back({current->children[i].get(), depth + 1});
+        }
     }
 }
 
@@ -1,9 +1,15 @@
 #ifndef AST_H
 #define AST_H
 
+#include <cstddef>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
+#include "source.h"
 #include "st.h"
 #include "st_types.h"
 
@@ -18,10 +24,12 @@ enum Type
 struct ASTNode
 {
     Type type;
-    std::string value;
+    std::shared_ptr<const std::string> value; // interned; shared with the nodes and identifiers of the same value
     std::weak_ptr<ASTNode> parent;
     std::vector<std::shared_ptr<ASTNode>> children;
 
+    ~ASTNode();
+
     /**
      * @brief Check if this node is a leaf node
      * @return true if this node is a leaf node, false otherwise
@@ -44,15 +52,116 @@ struct ASTNode
     friend std::ostream &operator<<(std::ostream &os, const ASTNode &node);
 };
 
+/**
+ * @brief Return the level of a token from the number of preceding dots
+ * @param str The token to check
+ * @return The level of the token
+ */
+int getLevel(std::string_view str);
+
+/**
+ * @brief Get the type of a token
+ * @param str The token to check
+ * @param level The level of the token
+ * @return A pair of type and value; the value is a view into the token
+ */
+std::pair<Type, std::string_view> getType(std::string_view str, int level);
+
+/**
+ * Interns the values of the nodes while an AST is read, so that all the nodes with the same value share one copy of it
+ */
+class StringTable
+{
+public:
+    /**
+     * @brief Get the shared copy of a value, copying it on its first use
+     * @param value The value
+     * @return The shared copy
+     */
+    std::shared_ptr<const std::string> intern(std::string_view value);
+
+private:
+    std::unordered_map<std::string_view, std::shared_ptr<const std::string>> strings; // the keys view the shared copies
+};
+
+class ASTReader
+{
+public:
+    virtual ~ASTReader() = default;
+
+    /**
+     * @brief Read the next node of the AST in preorder
+     * @param level Set to the depth of the node
+     * @param type Set to the type of the node
+     * @param value Set to the value of the node; the view is valid while the file is open
+     * @return true if a node was read, false at the end of the AST
+     */
+    virtual bool next(int &level, Type &type, std::string_view &value) = 0;
+};
+
+class TextASTReader : public ASTReader
+{
+public:
+    /**
+     * @brief Read an AST in the dotted text format, one node per line
+     * @param source The file containing the AST
+     */
+    TextASTReader(SourceFile &source);
+
+    bool next(int &level, Type &type, std::string_view &value) override;
+
+private:
+    SourceFile &source;
+};
+
+class BinaryASTReader : public ASTReader
+{
+public:
+    /**
+     * @brief Read an AST in the binary format written by AST::dumpBinary
+     * @param source The file containing the AST
+     */
+    BinaryASTReader(SourceFile &source);
+
+    bool next(int &level, Type &type, std::string_view &value) override;
+
+private:
+    std::string_view content;
+    std::size_t position;
+    std::vector<std::string_view> strings; // the string table, viewing the file
+    std::vector<std::size_t> remaining;    // number of children still to read of each open node, from the root
+
+    /**
+     * @brief Read an unsigned LEB128 number
+     * @return The number
+     */
+    std::size_t readVarint();
+};
+
 class AST
 {
 public:
     /**
      * @brief Construct a new AST object
-     * @param tokens A vector containing the tokens to parse
+     * @param reader The reader of the nodes
      * @return A new AST object
      */
-    static std::shared_ptr<AST> createAST(std::vector<std::string> tokens);
+    static std::shared_ptr<AST> createAST(ASTReader &reader);
+
+    /**
+     * @brief Standardize an AST while reading it, without building the AST
+     * @param reader The reader of the nodes
+     * @return The standardized tree
+     */
+    static std::shared_ptr<ST> streamStandardize(ASTReader &reader);
+
+    /**
+     * @brief Write an AST in the binary format: a header, a table of the distinct values, and the nodes in preorder as a
+     *        type, the index of the value and the number of children
+     * @param reader The reader of the nodes
+     * @param os The output stream to write to
+     */
+    static void dumpBinary(ASTReader &reader, std::ostream &os);
 
     AST();
 
@@ -87,10 +196,9 @@ private:
     /**
      * @brief Standardize the AST in postorder
      * @param node The node to standardize
-     * @param level The depth of the node
      * @return The standardized node
      */
-    std::shared_ptr<STNode> postOrder(std::shared_ptr<ASTNode> node, int level) const;
+    std::shared_ptr<STNode> postOrder(std::shared_ptr<ASTNode> node) const;
 
     std::shared_ptr<ASTNode> root;
     int size;
@@ -0,0 +1,238 @@
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "ast.h"
+
+using namespace std;
+
+shared_ptr<const string> StringTable::intern(string_view value)
+{
+    auto it = strings.find(value);
+    if (it != strings.end())
+    {
+        return it->second;
+    }
+
+    auto copy = make_shared<const string>(value);
+    strings.emplace(*copy, copy);
+    return copy;
+}
+
+// Header of the binary format; the last byte is the version of the format
+static const string_view BINARY_HEADER("RPALAST\x01", 8);
+
+/**
+ * @brief Remove the leading and trailing spaces from a line
+ * @param str The line
+ * @return The line without leading and trailing spaces
+ */
+static string_view trim(string_view str)
+{
+    const auto strBegin = str.find_first_not_of(" ");
+    if (strBegin == string_view::npos)
+        return ""; // no content
+
+    const auto strEnd = str.find_last_not_of(" ");
+    return str.substr(strBegin, strEnd - strBegin + 1);
+}
+
+/**
+ * @brief Write an unsigned LEB128 number
+ * @param value The number
+ * @param os The output stream to write to
+ */
+static void writeVarint(size_t value, ostream &os)
+{
+    do
+    {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        os.put(value != 0 ? byte | 0x80 : byte);
+    } while (value != 0);
+}
+
+TextASTReader::TextASTReader(SourceFile &source) : source(source)
+{
+}
+
+bool TextASTReader::next(int &level, Type &type, string_view &value)
+{
+    for (string_view line; source.nextLine(line);)
+    {
+        string_view token = trim(line);
+        if (token.empty())
+        {
+            continue;
+        }
+
+        level = getLevel(token);
+        auto parsed = getType(token, level);
+        type = parsed.first;
+        value = parsed.second;
+        return true;
+    }
+
+    return false;
+}
+
+BinaryASTReader::BinaryASTReader(SourceFile &source)
+{
+    content = source.getContent();
+    if (content.substr(0, BINARY_HEADER.length()) != BINARY_HEADER)
+    {
+        cerr << "Error: Not a binary AST file\n";
+        exit(EXIT_FAILURE);
+    }
+    position = BINARY_HEADER.length();
+
+    size_t count = readVarint();
+    if (count > content.length() - position)
+    {
+        cerr << "Error: Invalid binary AST\n";
+        exit(EXIT_FAILURE);
+    }
+
+    strings.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t length = readVarint();
+        if (length > content.length() - position)
+        {
+            cerr << "Error: Invalid binary AST\n";
+            exit(EXIT_FAILURE);
+        }
+
+        strings.push_back(content.substr(position, length));
+        position += length;
+    }
+}
+
+bool BinaryASTReader::next(int &level, Type &type, string_view &value)
+{
+    // Close the nodes whose children were all read
+    while (!remaining.empty() && remaining.back() == 0)
+    {
+        remaining.pop_back();
+    }
+
+    if (position >= content.length())
+    {
+        if (!remaining.empty())
+        {
+            cerr << "Error: Invalid binary AST\n";
+            exit(EXIT_FAILURE);
+        }
+        return false;
+    }
+
+    level = remaining.size();
+    if (!remaining.empty())
+    {
+        --remaining.back();
+    }
+
+    uint8_t kind = content[position++];
+    size_t index = readVarint();
+    if (kind > OTHER || index >= strings.size())
+    {
+        cerr << "Error: Invalid binary AST\n";
+        exit(EXIT_FAILURE);
+    }
+
+    type = (Type)kind;
+    value = strings[index];
+    remaining.push_back(readVarint());
+    return true;
+}
+
+size_t BinaryASTReader::readVarint()
+{
+    size_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (position >= content.length())
+        {
+            break;
+        }
+
+        uint8_t byte = content[position++];
+        value |= (size_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return value;
+        }
+    }
+
+    cerr << "Error: Invalid binary AST\n";
+    exit(EXIT_FAILURE);
+}
+
+void AST::dumpBinary(ASTReader &reader, ostream &os)
+{
+    struct Record
+    {
+        Type type;
+        size_t value;
+        size_t childCount;
+    };
+
+    vector<Record> records;
+    vector<size_t> open; // indices of the nodes whose subtrees are not read completely, from the root down
+    vector<string_view> strings;
+    unordered_map<string_view, size_t> indices;
+
+    int level;
+    Type type;
+    string_view value;
+    while (reader.next(level, type, value))
+    {
+        if (level > (int)open.size())
+        {
+            cerr << "Error: The AST skips a level\n";
+            exit(EXIT_FAILURE);
+        }
+
+        while ((int)open.size() > level)
+        {
+            open.pop_back();
+        }
+
+        if (open.empty() && !records.empty())
+        {
+            cerr << "Error: The AST has more than one root\n";
+            exit(EXIT_FAILURE);
+        }
+
+        auto it = indices.find(value);
+        if (it == indices.end())
+        {
+            it = indices.insert({value, strings.size()}).first;
+            strings.push_back(value);
+        }
+
+        if (!open.empty())
+        {
+            ++records[open.back()].childCount;
+        }
+        open.push_back(records.size());
+        records.push_back({type, it->second, 0});
+    }
+
+    os.write(BINARY_HEADER.data(), BINARY_HEADER.length());
+    writeVarint(strings.size(), os);
+    for (auto str : strings)
+    {
+        writeVarint(str.length(), os);
+        os.write(str.data(), str.length());
+    }
+
+    for (const auto &record : records)
+    {
+        os.put(record.type);
+        writeVarint(record.value, os);
+        writeVarint(record.childCount, os);
+    }
+}
@@ -0,0 +1,166 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include "cache.h"
+#include "source.h"
+
+using namespace std;
+
+// Header of an image file; the last byte is the version of the images, to be increased whenever their layout, the
+// instructions or the compiled programs change. The header is followed by the format and the content of the input, and
+// by a checksum of the rest of the image
+static const string_view IMAGE_HEADER("RPALCS\0\x05", 8);
+
+/**
+ * @brief Hash bytes with 64 bit FNV-1a
+ * @param data The bytes to hash
+ * @param hash The hash to continue from
+ * @return The hash
+ */
+static uint64_t fnv1a(string_view data, uint64_t hash = 14695981039346656037ULL)
+{
+    for (unsigned char byte : data)
+    {
+        hash ^= byte;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+string getDefaultCacheDirectory()
+{
+    const char *cacheHome = getenv("XDG_CACHE_HOME");
+    if (cacheHome != nullptr && *cacheHome != '\0')
+    {
+        return string(cacheHome) + "/myrpal";
+    }
+
+#ifdef _WIN32
+    const char *home = getenv("LOCALAPPDATA");
+    if (home != nullptr && *home != '\0')
+    {
+        return string(home) + "/myrpal";
+    }
+#else
+    const char *home = getenv("HOME");
+    if (home != nullptr && *home != '\0')
+    {
+        return string(home) + "/.cache/myrpal";
+    }
+#endif
+
+    return "";
+}
+
+ProgramCache::ProgramCache(string directory, string_view content, bool binary)
+{
+    this->directory = directory;
+    this->content = content;
+    this->format = binary ? 'b' : 't';
+    uint64_t hash = fnv1a(content, fnv1a(string_view(&format, 1), fnv1a(IMAGE_HEADER)));
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.rpalc", (unsigned long long)hash);
+    this->path = directory + "/" + name;
+}
+
+shared_ptr<ST> ProgramCache::load() const
+{
+    shared_ptr<SourceFile> file = make_shared<SourceFile>(path);
+    if (!file->isOpen())
+    {
+        return nullptr;
+    }
+
+    // The image must belong to the same input read in the same format, as the names only hold a hash of them
+    string_view image = file->getContent();
+    uint64_t length, checksum;
+    size_t offset = IMAGE_HEADER.length() + 1 + sizeof(length);
+    if (image.length() < offset || image.substr(0, IMAGE_HEADER.length()) != IMAGE_HEADER ||
+        image[IMAGE_HEADER.length()] != format)
+    {
+        return nullptr;
+    }
+    memcpy(&length, image.data() + IMAGE_HEADER.length() + 1, sizeof(length));
+    if (length != content.length() || image.length() - offset < length + sizeof(checksum) ||
+        image.substr(offset, length) != content)
+    {
+        return nullptr;
+    }
+    offset += length;
+    memcpy(&checksum, image.data() + offset, sizeof(checksum));
+    offset += sizeof(checksum);
+    if (checksum != fnv1a(image.substr(offset)))
+    {
+        return nullptr;
+    }
+
+    shared_ptr<ST> st = make_shared<ST>(nullptr);
+    if (!st->readProgram(file, offset))
+    {
+        return nullptr;
+    }
+    return st;
+}
+
+void ProgramCache::store(ST &st) const
+{
+    error_code error;
+    filesystem::create_directories(directory, error);
+    if (error)
+    {
+        return;
+    }
+
+    // Write to a temporary file first so that a concurrent run never maps a partial image
+    string temporary = path + "." + to_string(random_device()()) + ".tmp";
+    {
+        ofstream out(temporary, ios::binary);
+        if (!out)
+        {
+            return;
+        }
+
+        // The program is written first so that its checksum can precede it
+        ostringstream program;
+        if (!st.writeProgram(program))
+        {
+            out.close();
+            filesystem::remove(temporary, error);
+            return;
+        }
+        string image = program.str();
+        uint64_t checksum = fnv1a(image);
+
+        uint64_t length = content.length();
+
+        out.write(IMAGE_HEADER.data(), IMAGE_HEADER.length());
+        out.put(format);
+        out.write(reinterpret_cast<const char *>(&length), sizeof(length));
+        out.write(content.data(), content.length());
+        out.write(reinterpret_cast<const char *>(&checksum), sizeof(checksum));
+        out.write(image.data(), image.length());
+        if (!out.flush())
+        {
+            out.close();
+            filesystem::remove(temporary, error);
+            return;
+        }
+    }
+
+    filesystem::rename(temporary, path, error);
+    if (error)
+    {
+        filesystem::remove(temporary, error);
+    }
+}
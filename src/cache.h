@@ -0,0 +1,45 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include "st.h"
+
+/**
+ * @brief Get the default directory of the compiled program cache
+ * @return $XDG_CACHE_HOME/myrpal or ~/.cache/myrpal, or an empty string if neither can be determined
+ */
+std::string getDefaultCacheDirectory();
+
+class ProgramCache
+{
+public:
+    /**
+     * @brief Locate the cached image of a program, keyed by the input, its format and the version of the images
+     * @param directory The directory of the cache
+     * @param content The contents of the input file; they must outlive the cache
+     * @param binary Whether the input is a binary AST
+     */
+    ProgramCache(std::string directory, std::string_view content, bool binary);
+
+    /**
+     * @brief Load the cached image of the program
+     * @return A tree executing the cached control structures, or nullptr if there is no valid image
+     */
+    std::shared_ptr<ST> load() const;
+
+    /**
+     * @brief Store the control structures of a tree as the image of the program; failures are ignored
+     * @param st The tree of the program; all of its control structures are generated
+     */
+    void store(ST &st) const;
+
+private:
+    std::string directory;
+    std::string path;
+    std::string_view content; // the input, stored in the image and compared on loading
+    char format;              // 'b' for a binary AST, 't' for a text AST
+};
+
+#endif // CACHE_H
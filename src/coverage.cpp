@@ -0,0 +1,70 @@
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "coverage.h"
+
+using namespace std;
+
+/**
+ * @brief Format a count as a percentage of a total
+ * @param count The count
+ * @param total The total
+ * @return The percentage with one decimal
+ */
+static string percent(long count, long total)
+{
+    ostringstream os;
+    os << fixed << setprecision(1) << (total == 0 ? 0.0 : 100.0 * count / total) << "%";
+    return os.str();
+}
+
+Coverage::Coverage(const Program &program) : program(program)
+{
+    int deltaCount = program.getDeltaCount();
+    elements.resize(deltaCount);
+    entries.resize(deltaCount);
+    for (int i = 0; i < deltaCount; ++i)
+    {
+        elements[i].resize(program.getSize(i));
+    }
+}
+
+void Coverage::print(ostream &os) const
+{
+    long steps = machineSteps;
+    for (const auto &delta : elements)
+    {
+        for (const Element &element : delta)
+        {
+            steps += element.count;
+        }
+    }
+
+    os << "Steps: " << steps << ", of which " << machineSteps << " (" << percent(machineSteps, steps)
+       << ") execute environments and gammas placed by the machine\n";
+
+    for (int i = 0; i < (int)elements.size(); ++i)
+    {
+        long deltaSteps = 0;
+        for (const Element &element : elements[i])
+        {
+            deltaSteps += element.count;
+        }
+
+        os << "\ndelta_" << i << ": entered " << entries[i] << " times, " << deltaSteps << " steps (" << percent(deltaSteps, steps) << ")\n";
+
+        const Instruction *code = program.getCode(i);
+        for (int j = 0; j < (int)elements[i].size(); ++j)
+        {
+            const Element &element = elements[i][j];
+            os << setw(12) << element.count << setw(8) << percent(element.count, steps) << "  " << program.toString(code[j]);
+            if (code[j].opcode == OP_BETA || code[j].opcode == OP_BRANCH_INTEGER)
+            {
+                os << "  [then " << element.thenCount << " (" << percent(element.thenCount, element.count) << "), else "
+                   << element.elseCount << " (" << percent(element.elseCount, element.count) << ")]";
+            }
+            os << "\n";
+        }
+    }
+}
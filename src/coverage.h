@@ -0,0 +1,79 @@
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include <iostream>
+#include <vector>
+#include "program.h"
+
+/**
+ * Counts how often each element of the control structures is executed, how often each delta is entered and which way
+ * each conditional goes. The counts are printed as the control structures of -cs, one element per line.
+ */
+class Coverage
+{
+public:
+    /**
+     * @brief Create the counters for all the deltas of a program
+     * @param program The program; all of its control structures are generated
+     */
+    Coverage(const Program &program);
+
+    /**
+     * @brief Count an execution of an element
+     * @param delta The index of the delta of the element, -1 if the machine placed it
+     * @param offset The position of the element in the delta
+     */
+    void count(int delta, int offset)
+    {
+        if (delta < 0)
+        {
+            ++machineSteps;
+            last = nullptr;
+            return;
+        }
+
+        last = &elements[delta][offset];
+        ++last->count;
+    }
+
+    /**
+     * @brief Count the outcome of the conditional counted last
+     * @param condition Whether delta_then was chosen
+     */
+    void branch(bool condition)
+    {
+        if (last != nullptr)
+            ++(condition ? last->thenCount : last->elseCount);
+    }
+
+    /**
+     * @brief Count an entry to a delta
+     * @param delta The index of the delta
+     */
+    void enter(int delta)
+    {
+        ++entries[delta];
+    }
+
+    /**
+     * @brief Print the control structures with the counts
+     * @param os The output stream to write to
+     */
+    void print(std::ostream &os) const;
+
+private:
+    struct Element
+    {
+        long count = 0;
+        long thenCount = 0;
+        long elseCount = 0;
+    };
+
+    const Program &program;
+    std::vector<std::vector<Element>> elements; // counts of each element, by delta and position
+    std::vector<long> entries;                  // number of entries to each delta
+    long machineSteps = 0;                      // executed elements placed by the machine
+    Element *last = nullptr;                    // element counted last, nullptr if the machine placed it
+};
+
+#endif // COVERAGE_H
@@ -1,11 +1,23 @@
+#include <algorithm>
 #include <iostream>
-#include <iomanip>
+#include <cmath>
 #include <fstream>
+#include <functional>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
+#include "allocation.h"
+#include "coverage.h"
 #include "environment.h"
+#include "machine.h"
+#include "memory.h"
 #include "operators.h"
+#include "profile.h"
 #include "st.h"
 #include "st_types.h"
+#include "timeline.h"
+#include "trace.h"
 
 using namespace std;
 
@@ -26,13 +38,33 @@ shared_ptr<STNode> apply(shared_ptr<UnaryOperator> unOp, shared_ptr<STNode> rand
  */
 shared_ptr<STNode> apply(shared_ptr<BinaryOperator> binOp, shared_ptr<STNode> rand_l, shared_ptr<STNode> rand_r);
 
+/**
+ * @brief Apply a binary operator to two integers
+ * @param op The code of the operator
+ * @param rand_l The left operand
+ * @param rand_r The right operand
+ * @return The result of the operation, nullptr if the operator is not defined for integers
+ */
+shared_ptr<STNode> apply(int op, int rand_l, int rand_r);
+
+/**
+ * @brief Compare two integers
+ * @param op The code of the operator
+ * @param rand_l The left operand
+ * @param rand_r The right operand
+ * @param result Set to the result of the comparison
+ * @return true if the operator compares integers, false otherwise
+ */
+bool compare(int op, int rand_l, int rand_r, bool &result);
+
 /**
  * @brief Apply a built-in function
  * @param op The function
  * @param rand The argument
+ * @param numbering A function mapping the index of a lambda to the index shown when a closure is printed, or nullptr
  * @return The result of the application if all the arguments for the function is available, @p rand bounded function otherwise
  */
-shared_ptr<STNode> apply(shared_ptr<Function> op, shared_ptr<STNode> rand);
+shared_ptr<STNode> apply(shared_ptr<Function> op, shared_ptr<STNode> rand, const function<int(int)> &numbering);
 
 /**
  * @brief Print an error message and exit if operand is not compatible with the unary operator
@@ -54,24 +86,118 @@ void applyErr(shared_ptr<BinaryOperator> binOp, shared_ptr<STNode> rand_l, share
  */
 void stackUflowErr();
 
-void ST::runCSEMachine(vector<vector<shared_ptr<STNode>>> &controlStructures, bool printExe)
-{
-    ofstream out;
+/**
+ * @brief Get the CSE rule a step will apply without executing it
+ * @param next The next instruction
+ * @param stack The stack before the step
+ * @param env The current environment
+ * @param program The program the instruction belongs to
+ * @return The rule, 0 if the step will fail
+ */
+int predictRule(const Instruction &next, const MachineStack &stack, shared_ptr<Environment> env, const Program &program);
 
-    if (printExe)
-        out.open("exec.txt");
+/**
+ * @brief Check whether a step is written to the text trace
+ * @param options The execution options
+ * @param state The state of the machine before the step
+ * @param env The current environment
+ * @return true if the step is traced, false otherwise
+ */
+bool isTraced(const ExecutionOptions &options, const MachineState &state, shared_ptr<Environment> env);
 
-    vector<shared_ptr<STNode>> stack;
-    vector<shared_ptr<STNode>> control;
+/**
+ * @brief Write the steps kept by the flight recorder of the running machine to flight.txt, flush the trace, print the
+ *        memory peak, close the timeline and exit
+ */
+[[noreturn]] void fail();
+
+/**
+ * @brief Get the value of an identifier according to CSE Rule 1
+ * @param identifier The identifier
+ * @param env The environment to start search
+ * @return The bound value, or a copy of it if it is a built-in function
+ */
+shared_ptr<STNode> lookupIdentifier(shared_ptr<STNode> identifier, shared_ptr<Environment> env);
+
+// Flight recorder, program, tracer and memory profiler of the running machine, used when the execution fails
+static const FlightRecorder *activeRecorder = nullptr;
+static Tracer *activeTracer = nullptr;
+static const Program *activeProgram = nullptr;
+static const MemoryProfiler *activeMemory = nullptr;
+
+void ST::runCSEMachine(const ExecutionOptions &options)
+{
+    unique_ptr<Tracer> tracer;
+    if (options.printExe)
+        tracer = make_unique<TextTracer>("exec.txt");
+    else if (options.compactTrace > 0)
+        tracer = make_unique<CompactTracer>("exec.compact", options.compactTrace);
+    else if (options.binaryTrace)
+        tracer = make_unique<BinaryTracer>("exec.bin");
+
+    MachineStack stack;
+    vector<Instruction> control;
     vector<shared_ptr<Environment>> envs;
+    Statistics *stats = statistics;
+    AllocationProfile *allocations = AllocationProfile::active;
+    Timeline *timeline = Timeline::active;
+    unique_ptr<Profiler> profiler;
+    if (options.profileInterval > 0)
+        profiler = make_unique<Profiler>(options.profileInterval);
+    unique_ptr<MemoryProfiler> memory;
+    if (options.memoryInterval > 0 && allocations)
+        memory = make_unique<MemoryProfiler>("memory.csv", options.memoryInterval, *allocations);
+    FlightRecorder recorder;
+    activeRecorder = &recorder;
+    activeProgram = &program;
+    activeTracer = tracer.get();
+    activeMemory = memory.get();
+
+    unique_ptr<Coverage> coverage;
+    if (options.coverage)
+        coverage = make_unique<Coverage>(program);
+
+    // Lazily generated deltas are numbered as they are identified; closures and functions are shown with the numbers of
+    // a full generation
+    function<int(int)> numbering;
+    if (!compiled)
+        numbering = [this](int index)
+        { return getNumber(index); };
+
+    // Start of each run of the control loaded at once and the delta it came from, -1 if the machine placed it; only kept
+    // while tracing or counting coverage
+    bool segmented = tracer || coverage;
+    vector<pair<size_t, int>> segments;
+    auto enter = [&](int delta)
+    {
+        if (segmented)
+            segments.push_back({control.size(), delta});
+        if (coverage && delta >= 0)
+            coverage->enter(delta);
+    };
+
+    // Operators applied by the superinstructions when the value of the identifier is not an integer
+    vector<shared_ptr<BinaryOperator>> binaryOperators;
+    for (int i = ADD; i <= NE; ++i)
+    {
+        binaryOperators.push_back(makeNode<BinaryOperator>(getBinOpName(i)));
+    }
 
-    shared_ptr<Environment> e_0 = make_shared<Environment>(); // primitive environment
+    const Instruction gamma = {OP_GAMMA, 0, 0, 0, 0};
+
+    shared_ptr<Environment> e_0 = makeNode<Environment>(); // primitive environment
     stack.push_back(e_0);
-    control.push_back(e_0);
+    enter(-1);
+    control.push_back({OP_ENVIRONMENT, 0, e_0->getIndex(), 0, 0});
     envs.push_back(e_0);
-    control.insert(control.end(), controlStructures[0].begin(), controlStructures[0].end()); // control structures for entry point
+    const Instruction *entry = getCode(0);
+    enter(0);
+    control.insert(control.end(), entry, entry + program.getSize(0)); // control structures for entry point
 
     shared_ptr<Environment> currentEnvironment = e_0;
+    MachineState state = {0, control, stack, program, e_0->getIndex(), 0};
+    if (allocations)
+        allocations->attribute(0); // the allocations so far were not made by a step
     while (true)
     {
         if (control.empty())
@@ -79,72 +205,118 @@ void ST::runCSEMachine(vector<vector<shared_ptr<STNode>>> &controlStructures, bo
             break; // end of execution
         }
 
-        if (printExe)
+        ++state.step;
+        bool traced = false; // whether the step is written to the trace
+        recorder.startStep(state.step, control.back(), stack.size(), state.environment);
+        if (profiler)
+            profiler->step();
+        if (memory)
+            memory->step(state);
+        if (segmented)
         {
-            out << setw(8) << "Control"
-                << ": ";
-            for (int i = 0; i < (int)control.size(); ++i)
-            {
-                auto node = control[i];
-                out << (node->getType() == "String" ? ("'" + node->toString() + "'") : node->toString()) << (i == (int)control.size() - 1 ? "\n" : " ");
-            }
-            out << setw(8) << "Stack"
-                << ": ";
-            for (int i = stack.size() - 1; i >= 0; --i)
-            {
-                auto node = stack[i];
-                out << (node->getType() == "String" ? ("'" + node->toString() + "'") : node->toString()) << (i == 0 ? "\n" : " ");
-            }
+            while (segments.back().first >= control.size())
+                segments.pop_back();
+            state.delta = segments.back().second;
+            if (coverage)
+                coverage->count(state.delta, control.size() - 1 - segments.back().first);
+        }
+        if (tracer)
+        {
+            stack.resetLow();
+            traced = !options.printExe || isTraced(options, state, currentEnvironment);
+            if (traced)
+                tracer->startStep(state);
         }
 
-        int controlSize = control.size();
-        shared_ptr<STNode> next = control[controlSize - 1]; // next node to be executed
+        Instruction next = control.back(); // next instruction to be executed
         control.pop_back();
 
-        if (printExe)
-            out << setw(8) << "Next"
-                << ": " << (next->getType() == "String" ? ("'" + next->toString() + "'") : next->toString()) << "\n";
+        int rule = 1; // the CSE rule applied in this step
+        switch (next.opcode)
+        {
+        case OP_IDENTIFIER:
+        {
+            // CSE Rule 1
+            shared_ptr<STNode> value = lookupIdentifier(program.getConstant(next.a), currentEnvironment); // get the value of the identifier from the environment
+            stack.push_back(value);                                                                      // push the value of the identifier to the stack
+            break;
+        }
+
+        case OP_CONSTANT:
+            // CSE Rule 1
+            stack.push_back(program.getConstant(next.a));
+            break;
 
-        // CSE Rule 1
-        if (next->getType() == "Identifier")
+        case OP_TUPLE:
+            // Take a copy before putting to the stack if next is a tuple
+            stack.push_back(static_pointer_cast<Tuple>(program.getConstant(next.a))->getCopy());
+            if (stats)
+                ++stats->tuples;
+            break;
+
+        case OP_LAMBDA:
+        {
+            // CSE Rule 2
+            shared_ptr<Lambda> l = static_pointer_cast<Lambda>(program.getConstant(next.a))->getCopy(); // take a copy of the lambda node
+            l->setEnv(currentEnvironment->getIndex());                                                 // set the environment of the lambda node to the current environment
+            stack.push_back(l);                                                                        // push the lambda node to the stack
+            rule = 2;
+            break;
+        }
+
+        case OP_OPERATE_INTEGER:
+        case OP_BRANCH_INTEGER:
         {
-            string name = dynamic_pointer_cast<Identifier>(next)->getName(); // name of the identifier
-            shared_ptr<STNode> value = lookup(name, currentEnvironment);     // get the value of the identifier from the environment
+            // Apply the binary operator to the value of the identifier and the integer without going through the stack
+            shared_ptr<STNode> rand_l = lookupIdentifier(program.getConstant(next.a), currentEnvironment);
+            bool isInteger = rand_l->getType() == "Integer";
 
-            if (value == nullptr)
+            if (next.opcode == OP_OPERATE_INTEGER)
             {
-                // The identifier is not defined in the current environment, a parent environment of it, or the primitive environment
-                cerr << "Error: Identifier " << name << " is not defined.\n";
-                exit(EXIT_FAILURE);
+                // CSE Rule 6
+                shared_ptr<STNode> result = isInteger ? apply(next.op, static_pointer_cast<Integer>(rand_l)->getValue(), next.b) : nullptr;
+                if (result == nullptr)
+                {
+                    result = apply(binaryOperators[next.op], rand_l, makeNode<Integer>(next.b));
+                }
+
+                stack.push_back(result);
+                rule = 6;
+                break;
             }
-            else if (value->getType() == "Function")
+
+            // CSE Rule 8
+            bool condition;
+            if (!isInteger || !compare(next.op, static_pointer_cast<Integer>(rand_l)->getValue(), next.b, condition))
             {
-                // The identifier is a built-in function; Therefore, take a copy
-                value = dynamic_pointer_cast<Function>(value)->getCopy();
+                shared_ptr<STNode> result = apply(binaryOperators[next.op], rand_l, makeNode<Integer>(next.b));
+                if (result->getType() != "TruthValue")
+                {
+                    cerr << "Error: Expected truth value.\n";
+                    fail();
+                }
+                condition = static_pointer_cast<TruthValue>(result)->getValue();
             }
 
-            stack.push_back(value); // push the value of the identifier to the stack
-            if (printExe)
-                out << setw(8) << "Rule"
-                    << ": " << 1 << "\n\n";
-            continue;
+            if (coverage)
+                coverage->branch(condition);
+            int delta_index = condition ? next.c : next.c + 1; // delta_else immediately follows delta_then
+            const Instruction *_delta = getCode(delta_index);
+            enter(delta_index);
+            control.insert(control.end(), _delta, _delta + program.getSize(delta_index));
+            rule = 8;
+            break;
         }
 
-        // CSE Rule 2
-        if (next->getType() == "Lambda")
-        {
-            shared_ptr<Lambda> l = dynamic_pointer_cast<Lambda>(next)->getCopy(); // take a copy of the lambda node
-            l->setEnv(currentEnvironment->getIndex());                            // set the environment of the lambda node to the current environment
-            stack.push_back(l);                                                   // push the lambda node to the stack
-            if (printExe)
-                out << setw(8) << "Rule"
-                    << ": " << 2 << "\n\n";
-            continue;
-        }
+        case OP_APPLY_IDENTIFIERS:
+            // CSE Rule 1 for the rand and the rator; the application is handled as a gamma
+            stack.push_back(lookupIdentifier(program.getConstant(next.b), currentEnvironment));
+            stack.push_back(lookupIdentifier(program.getConstant(next.a), currentEnvironment));
+            [[fallthrough]];
 
-        if (next->getType() == "Gamma")
+        case OP_GAMMA:
         {
-            if (stack.size() < 3)
+            if (checked && stack.size() < 3)
             {
                 stackUflowErr();
             }
@@ -152,7 +324,7 @@ void ST::runCSEMachine(vector<vector<shared_ptr<STNode>>> &controlStructures, bo
             shared_ptr<STNode> rator = stack[stack.size() - 1]; // rator of the application
             shared_ptr<STNode> rand = stack[stack.size() - 2];  // rand of the application
 
-            if (rator->getType() == "Environment" || rand->getType() == "Environment")
+            if (checked && (rator->getType() == "Environment" || rand->getType() == "Environment"))
             {
                 // The rator or rand is an environment, which is not allowed
                 stackUflowErr();
@@ -162,8 +334,10 @@ void ST::runCSEMachine(vector<vector<shared_ptr<STNode>>> &controlStructures, bo
             stack.pop_back();
             stack.pop_back();
 
+            string ratorType = rator->getType();
+
             // CSE Rule 3
-            if (rator->getType() == "Function")
+            if (ratorType == "Function")
             {
                 /**
                  * Rator is a built-in function
@@ -172,24 +346,23 @@ void ST::runCSEMachine(vector<vector<shared_ptr<STNode>>> &controlStructures, bo
                  *   Otherwise, result will be the built-in function with the arguments bounded for future reference
                  * Push the result to the stack
                  */
-                shared_ptr<STNode> result = apply(dynamic_pointer_cast<Function>(rator), rand);
+                shared_ptr<STNode> result = apply(static_pointer_cast<Function>(rator), rand, numbering);
                 stack.push_back(result);
-                if (printExe)
-                    out << setw(8) << "Rule"
-                        << ": " << 3 << "\n\n";
-                continue;
+                if (stats && result->getType() == "String")
+                    ++stats->strings; // the string functions always return a new string
+                rule = 3;
+                break;
             }
 
             // CSE Rule 4 & CSE Rule 11
-            if (rator->getType() == "Lambda")
+            if (ratorType == "Lambda")
             {
-                shared_ptr<Lambda> l = dynamic_pointer_cast<Lambda>(rator);  // lambda node
-                shared_ptr<Environment> newEnv = make_shared<Environment>(); // new environment for the lambda node
+                shared_ptr<Lambda> l = static_pointer_cast<Lambda>(rator);   // lambda node
+                shared_ptr<Environment> newEnv = makeNode<Environment>(); // new environment for the lambda node
 
                 newEnv->setParent(envs[l->getEnv()]); // set the parent of the new environment to the environment of the lambda node
-                if (printExe)
-                    out << setw(8) << "New Env"
-                        << ": " << newEnv->getIndex() << "\n";
+                if (traced)
+                    tracer->newEnvironment(newEnv->getIndex());
 
                 envs.push_back(newEnv);
 
@@ -203,131 +376,137 @@ void ST::runCSEMachine(vector<vector<shared_ptr<STNode>>> &controlStructures, bo
                     if (rand->getType() == "Tuple")
                     {
                         // The rand should be a tuple node with the same number of elements as the number of bindings
-                        shared_ptr<Tuple> t = dynamic_pointer_cast<Tuple>(rand);
+                        shared_ptr<Tuple> t = static_pointer_cast<Tuple>(rand);
                         int order = t->getOrder();
 
                         if (order != bindingCnt)
                         {
                             cerr << "Error: Expected " << l->getBindingCount() << " arguments but got " << order << ".\n";
-                            exit(EXIT_FAILURE);
+                            fail();
                         }
 
-                        if (printExe)
-                            out << setw(8) << "Bindings"
-                                << ": ";
                         for (int i = 0; i < bindingCnt; ++i)
                         {
                             // Bind the all identifiers to corresponding value in the new environment
-                            string name = dynamic_pointer_cast<Identifier>(bindings[i])->getName();
+                            string name = bindings[i]->getName();
                             newEnv->addVariable(name, (*t)[i]);
-                            if (printExe)
-                                out << "(" << name << " = " << (*t)[i]->toString() << ")" << (i == bindingCnt - 1 ? "\n" : ", ");
                         }
 
-                        if (printExe)
-                            out << setw(8) << "Rule"
-                                << ": " << 11 << "\n\n";
+                        if (traced)
+                        {
+                            vector<pair<string, shared_ptr<STNode>>> bound;
+                            for (int i = 0; i < bindingCnt; ++i)
+                            {
+                                bound.push_back({bindings[i]->getName(), (*t)[i]});
+                            }
+                            tracer->bind(bound);
+                        }
+
+                        rule = 11;
                     }
                     else
                     {
                         cerr << "Error: Expected " << l->getBindingCount() << " arguments but got 1.\n";
-                        exit(EXIT_FAILURE);
+                        fail();
                     }
                 }
                 else
                 {
                     // CSE Rule 4
-                    if (printExe)
-                        out << setw(8) << "Bindings"
-                            << ": ";
-                    string name = dynamic_pointer_cast<Identifier>(bindings[0])->getName();
+                    string name = bindings[0]->getName();
                     newEnv->addVariable(name, rand); // Bind the identifier to the value in the new environment
-                    if (printExe)
-                        out << "(" << name << " = " << rand->toString() << ")\n"
-                            << setw(8) << "Rule"
-                            << ": " << 4 << "\n\n";
+                    if (traced)
+                        tracer->bind({{name, rand}});
+                    rule = 4;
                 }
 
                 currentEnvironment = newEnv; // Enter the new environment
-                control.push_back(newEnv);
+                state.environment = newEnv->getIndex();
+                if (profiler || timeline || memory)
+                {
+                    int number = numbering ? numbering(l->getIndex()) : l->getIndex();
+                    if (profiler)
+                        profiler->enter(*l, number);
+                    if (timeline)
+                        timeline->enter(*l, number);
+                    if (memory)
+                        memory->enter(*l, number);
+                }
+                enter(-1);
+                control.push_back({OP_ENVIRONMENT, 0, newEnv->getIndex(), 0, 0});
                 stack.push_back(newEnv);
-                vector<shared_ptr<STNode>> _delta = controlStructures[l->getIndex()];
-                control.insert(control.end(), _delta.begin(), _delta.end()); // Load the control structures corresponding to the lambda node
-                continue;
+                const Instruction *_delta = getCode(l->getIndex());
+                enter(l->getIndex());
+                control.insert(control.end(), _delta, _delta + program.getSize(l->getIndex())); // Load the control structures corresponding to the lambda node
+                break;
             }
 
             // CSE Rule 10
-            if (rator->getType() == "Tuple")
+            if (ratorType == "Tuple")
             {
                 if (rand->getType() != "Integer")
                 {
                     // The rand should be an integer
                     cerr << "Error: Tuple index must be an integer.\n";
-                    exit(EXIT_FAILURE);
+                    fail();
                 }
 
-                shared_ptr<Tuple> t = dynamic_pointer_cast<Tuple>(rator);
-                int index = dynamic_pointer_cast<Integer>(rand)->getValue() - 1;
+                shared_ptr<Tuple> t = static_pointer_cast<Tuple>(rator);
+                int index = static_pointer_cast<Integer>(rand)->getValue() - 1;
                 shared_ptr<STNode> value = (*t)[index]; // Get the value at the index
                 if (value == nullptr)
                 {
                     // Index out of range
                     cerr << "Error: Tuple index out of range.\n";
-                    exit(EXIT_FAILURE);
+                    fail();
                 }
 
                 stack.push_back(value); // Push the value to the stack
-                if (printExe)
-                    out << setw(8) << "Rule"
-                        << ": " << 10 << "\n\n";
-                continue;
+                rule = 10;
+                break;
             }
 
             // CSE Rule 12
-            if (rator->getType() == "YStar")
+            if (ratorType == "YStar")
             {
                 if (rand->getType() != "Lambda")
                 {
                     // The rand should be a lambda node
                     cerr << "Error: Recursion Error.\n";
-                    exit(EXIT_FAILURE);
+                    fail();
                 }
 
-                shared_ptr<YStar> y = dynamic_pointer_cast<YStar>(rator);
-                shared_ptr<Lambda> l = dynamic_pointer_cast<Lambda>(rand);
-                shared_ptr<Eta> e = make_shared<Eta>(l); // Create an eta node for the lambda
+                shared_ptr<Lambda> l = static_pointer_cast<Lambda>(rand);
+                shared_ptr<Eta> e = makeNode<Eta>(l); // Create an eta node for the lambda
                 stack.push_back(e);                      // Push the eta node to the stack
-                if (printExe)
-                    out << setw(8) << "Rule"
-                        << ": " << 12 << "\n\n";
-                continue;
+                rule = 12;
+                break;
             }
 
             // CSE Rule 13
-            if (rator->getType() == "Eta")
+            if (ratorType == "Eta")
             {
-                shared_ptr<Eta> e = dynamic_pointer_cast<Eta>(rator);
+                shared_ptr<Eta> e = static_pointer_cast<Eta>(rator);
                 shared_ptr<Lambda> l = e->getLambda();
 
-                stack.push_back(rand);                   // Push the rand back to the stack
-                stack.push_back(e);                      // Push the eta node to the stack
-                stack.push_back(l);                      // Push the lambda node to the stack
-                control.push_back(make_shared<Gamma>()); // Push a gamma node to the control to bind the lambda node back to the eta node for recursion
-                control.push_back(make_shared<Gamma>()); // Push a gamma node to the control to apply rand
-                if (printExe)
-                    out << setw(8) << "Rule"
-                        << ": " << 13 << "\n\n";
-                continue;
+                stack.push_back(rand);    // Push the rand back to the stack
+                stack.push_back(e);       // Push the eta node to the stack
+                stack.push_back(l);       // Push the lambda node to the stack
+                enter(-1);
+                control.push_back(gamma); // Push a gamma to the control to bind the lambda node back to the eta node for recursion
+                control.push_back(gamma); // Push a gamma to the control to apply rand
+                rule = 13;
+                break;
             }
 
             cerr << "Error: Illegal Function Application.\n";
-            exit(EXIT_FAILURE);
+            fail();
         }
 
-        // CSE Rule 5
-        if (next->getType() == "Environment")
+        case OP_ENVIRONMENT:
         {
-            if (stack.size() < 2)
+            // CSE Rule 5
+            if (checked && stack.size() < 2)
             {
                 stackUflowErr();
             }
@@ -335,17 +514,17 @@ void ST::runCSEMachine(vector<vector<shared_ptr<STNode>>> &controlStructures, bo
             shared_ptr<STNode> v = stack[stack.size() - 1];
             shared_ptr<STNode> e = stack[stack.size() - 2];
 
-            if (v->getType() == "Environment")
+            if (checked && v->getType() == "Environment")
             {
                 // Stack top should be a value
                 stackUflowErr();
             }
 
-            if (e->getType() != "Environment")
+            if (checked && e->getType() != "Environment")
             {
                 // Node below the stack top should be an environment
                 cerr << "Error: Expected environment.\n";
-                exit(EXIT_FAILURE);
+                fail();
             }
 
             // Exit from the current environment
@@ -360,30 +539,36 @@ void ST::runCSEMachine(vector<vector<shared_ptr<STNode>>> &controlStructures, bo
                 it = stack[i];
                 if (it->getType() == "Environment")
                 {
-                    currentEnvironment = dynamic_pointer_cast<Environment>(it);
+                    currentEnvironment = static_pointer_cast<Environment>(it);
+                    state.environment = currentEnvironment->getIndex();
                     break;
                 }
             }
 
-            if (printExe)
-                out << setw(8) << "Rule"
-                    << ": " << 5 << "\n\n";
-            continue;
+            if (profiler)
+                profiler->leave();
+            if (timeline)
+                timeline->leave();
+            if (memory)
+                memory->leave();
+
+            rule = 5;
+            break;
         }
 
-        // CSE Rule 6
-        if (next->getType() == "BinaryOperator")
+        case OP_BINARY:
         {
-            if (stack.size() < 3)
+            // CSE Rule 6
+            if (checked && stack.size() < 3)
             {
                 stackUflowErr();
             }
 
-            shared_ptr<BinaryOperator> binOp = dynamic_pointer_cast<BinaryOperator>(next);
+            shared_ptr<BinaryOperator> binOp = static_pointer_cast<BinaryOperator>(program.getConstant(next.a));
             shared_ptr<STNode> rand_l = stack[stack.size() - 1]; // Left operand
             shared_ptr<STNode> rand_r = stack[stack.size() - 2]; // Right operand
 
-            if (rand_l->getType() == "Environment" || rand_r->getType() == "Environment")
+            if (checked && (rand_l->getType() == "Environment" || rand_r->getType() == "Environment"))
             {
                 stackUflowErr();
             }
@@ -393,24 +578,22 @@ void ST::runCSEMachine(vector<vector<shared_ptr<STNode>>> &controlStructures, bo
 
             shared_ptr<STNode> result = apply(binOp, rand_l, rand_r); // Apply the binary operator to the operands
             stack.push_back(result);                                  // Push the result to the stack
-            if (printExe)
-                out << setw(8) << "Rule"
-                    << ": " << 6 << "\n\n";
-            continue;
+            rule = 6;
+            break;
         }
 
-        // CSE Rule 7
-        if (next->getType() == "UnaryOperator")
+        case OP_UNARY:
         {
-            if (stack.size() < 2)
+            // CSE Rule 7
+            if (checked && stack.size() < 2)
             {
                 stackUflowErr();
             }
 
-            shared_ptr<UnaryOperator> unOp = dynamic_pointer_cast<UnaryOperator>(next);
+            shared_ptr<UnaryOperator> unOp = static_pointer_cast<UnaryOperator>(program.getConstant(next.a));
             shared_ptr<STNode> rand = stack[stack.size() - 1]; // Operand
 
-            if (rand->getType() == "Environment")
+            if (checked && rand->getType() == "Environment")
             {
                 stackUflowErr();
             }
@@ -419,23 +602,21 @@ void ST::runCSEMachine(vector<vector<shared_ptr<STNode>>> &controlStructures, bo
 
             shared_ptr<STNode> result = apply(unOp, rand); // Apply the unary operator to the operand
             stack.push_back(result);                       // Push the result to the stack
-            if (printExe)
-                out << setw(8) << "Rule"
-                    << ": " << 7 << "\n\n";
-            continue;
+            rule = 7;
+            break;
         }
 
-        // CSE Rule 8
-        if (next->getType() == "Beta")
+        case OP_BETA:
         {
-            if (stack.size() < 2)
+            // CSE Rule 8
+            if (checked && stack.size() < 2)
             {
                 stackUflowErr();
             }
 
             shared_ptr<STNode> v = stack[stack.size() - 1]; // Boolean value of the condition
 
-            if (v->getType() == "Environment")
+            if (checked && v->getType() == "Environment")
             {
                 stackUflowErr();
             }
@@ -443,70 +624,49 @@ void ST::runCSEMachine(vector<vector<shared_ptr<STNode>>> &controlStructures, bo
             if (v->getType() != "TruthValue")
             {
                 cerr << "Error: Expected truth value.\n";
-                exit(EXIT_FAILURE);
+                fail();
             }
 
-            shared_ptr<TruthValue> tv = dynamic_pointer_cast<TruthValue>(v);
+            shared_ptr<TruthValue> tv = static_pointer_cast<TruthValue>(v);
             stack.pop_back();
-
-            shared_ptr<Beta>
-                beta = dynamic_pointer_cast<Beta>(next);
-            if (control.size() < 3)
-            {
-                cerr << "Error: Control underflow.\n";
-                exit(EXIT_FAILURE);
-            }
-
-            shared_ptr<STNode> _next_1 = control[control.size() - 1]; // delta_else
-            shared_ptr<STNode> _next_2 = control[control.size() - 2]; // delta_then
-            control.pop_back();
-            control.pop_back();
-
-            if (_next_1->getType() != "Delta" || _next_2->getType() != "Delta")
-            {
-                cerr << "Error: Expected delta.\n";
-                exit(EXIT_FAILURE);
-            }
-
-            shared_ptr<Delta> delta_else = dynamic_pointer_cast<Delta>(_next_1);
-            shared_ptr<Delta> delta_then = dynamic_pointer_cast<Delta>(_next_2);
+            if (coverage)
+                coverage->branch(tv->getValue());
 
             int delta_index;
             if (tv->getValue())
             {
                 // Condition is true => Load control structures of delta_then
-                delta_index = delta_then->getIndex();
+                delta_index = next.a;
             }
             else
             {
                 // Condition is false => Load control structures of delta_else
-                delta_index = delta_else->getIndex();
+                delta_index = next.b;
             }
 
-            control.insert(control.end(), controlStructures[delta_index].begin(), controlStructures[delta_index].end());
-            if (printExe)
-                out << setw(8) << "Rule"
-                    << ": " << 8 << "\n\n";
-            continue;
+            const Instruction *_delta = getCode(delta_index);
+            enter(delta_index);
+            control.insert(control.end(), _delta, _delta + program.getSize(delta_index));
+            rule = 8;
+            break;
         }
 
-        // CSE Rule 9
-        if (next->getType() == "Tau")
+        case OP_TAU:
         {
-            shared_ptr<Tau> tau = dynamic_pointer_cast<Tau>(next);
-            int n = tau->getSize();
+            // CSE Rule 9
+            int n = next.a;
 
-            if ((int)stack.size() <= n)
+            if (checked && (int)stack.size() <= n)
             {
                 stackUflowErr();
             }
 
-            shared_ptr<Tuple> tuple = make_shared<Tuple>(); // Create a new tuple
+            shared_ptr<Tuple> tuple = makeNode<Tuple>(); // Create a new tuple
             for (int i = 0; i < n; ++i)
             {
                 auto elem = stack[stack.size() - 1];
 
-                if (elem->getType() == "Environment")
+                if (checked && elem->getType() == "Environment")
                 {
                     stackUflowErr();
                 }
@@ -516,28 +676,116 @@ void ST::runCSEMachine(vector<vector<shared_ptr<STNode>>> &controlStructures, bo
             }
 
             stack.push_back(tuple); // Push the tuple to the stack
-            if (printExe)
-                out << setw(8) << "Rule"
-                    << ": " << 9 << "\n\n";
-            continue;
+            if (stats)
+                ++stats->tuples;
+            rule = 9;
+            break;
+        }
         }
 
-        if (printExe)
-            out << setw(8) << "Rule"
-                << ": 1\n\n";
-
-        if (next->getType() == "Tuple")
+        recorder.endStep(rule);
+        if (allocations)
+            allocations->attribute(rule);
+        if (stats)
         {
-            // Take a copy before putting to the stack if next is a tuple
-            stack.push_back(dynamic_pointer_cast<Tuple>(next)->getCopy());
-            continue;
+            ++stats->rules[rule];
+            stats->peakControl = max(stats->peakControl, control.size());
+            stats->peakStack = max(stats->peakStack, stack.size());
         }
+        if (traced)
+            tracer->endStep(state, rule);
+    }
+
+    activeRecorder = nullptr;
+    activeProgram = nullptr;
+    activeTracer = nullptr;
+    activeMemory = nullptr;
+
+    if (profiler)
+    {
+        ofstream out("profile.folded");
+        profiler->write(out);
+    }
 
-        stack.push_back(next);
+    if (coverage)
+    {
+        ofstream out("coverage.txt");
+        coverage->print(out);
+    }
+
+    if (memory)
+    {
+        memory->finish(state);
+        memory->printPeak(cerr);
     }
 
-    if (printExe)
-        out.close();
+    if (stats)
+    {
+        stats->environments += envs.size();
+        stats->closures += stats->rules[2] + stats->rules[12];
+    }
+}
+
+int predictRule(const Instruction &next, const MachineStack &stack, shared_ptr<Environment> env, const Program &program)
+{
+    shared_ptr<STNode> rator;
+    switch (next.opcode)
+    {
+    case OP_IDENTIFIER:
+    case OP_CONSTANT:
+    case OP_TUPLE:
+        return 1;
+    case OP_LAMBDA:
+        return 2;
+    case OP_ENVIRONMENT:
+        return 5;
+    case OP_BINARY:
+    case OP_OPERATE_INTEGER:
+        return 6;
+    case OP_UNARY:
+        return 7;
+    case OP_BETA:
+    case OP_BRANCH_INTEGER:
+        return 8;
+    case OP_TAU:
+        return 9;
+    case OP_APPLY_IDENTIFIERS:
+        rator = lookup(static_pointer_cast<Identifier>(program.getConstant(next.a))->getName(), env);
+        break;
+    case OP_GAMMA:
+        if (stack.size() > 0)
+            rator = stack[stack.size() - 1];
+        break;
+    }
+
+    if (rator == nullptr)
+        return 0;
+
+    string ratorType = rator->getType();
+    if (ratorType == "Function")
+        return 3;
+    if (ratorType == "Lambda")
+        return static_pointer_cast<Lambda>(rator)->getBindingCount() > 1 ? 11 : 4;
+    if (ratorType == "Tuple")
+        return 10;
+    if (ratorType == "YStar")
+        return 12;
+    if (ratorType == "Eta")
+        return 13;
+    return 0;
+}
+
+bool isTraced(const ExecutionOptions &options, const MachineState &state, shared_ptr<Environment> env)
+{
+    if (state.step < options.traceFrom || (options.traceTo >= 0 && state.step > options.traceTo))
+        return false;
+    if ((state.step - options.traceFrom) % options.traceEvery != 0)
+        return false;
+    if (!options.traceDeltas.empty() && options.traceDeltas.count(state.delta) == 0)
+        return false;
+    if (!options.traceRules.empty() && options.traceRules.count(predictRule(state.control.back(), state.stack, env, state.program)) == 0)
+        return false;
+    return true;
 }
 
 shared_ptr<STNode> apply(shared_ptr<UnaryOperator> unOp, shared_ptr<STNode> rand)
@@ -552,7 +800,7 @@ shared_ptr<STNode> apply(shared_ptr<UnaryOperator> unOp, shared_ptr<STNode> rand
         else
         {
             applyErr(unOp, rand);
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
     else if (unOpStr == "neg")
@@ -564,13 +812,13 @@ shared_ptr<STNode> apply(shared_ptr<UnaryOperator> unOp, shared_ptr<STNode> rand
         else
         {
             applyErr(unOp, rand);
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
     else
     {
         cerr << "Error: Unknown unary operator.\n";
-        exit(EXIT_FAILURE);
+        fail();
     }
 }
 
@@ -586,7 +834,7 @@ shared_ptr<STNode> apply(shared_ptr<BinaryOperator> binOp, shared_ptr<STNode> ra
         else
         {
             applyErr(binOp, rand_l, rand_r);
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
     else if (binOpStr == "-")
@@ -598,7 +846,7 @@ shared_ptr<STNode> apply(shared_ptr<BinaryOperator> binOp, shared_ptr<STNode> ra
         else
         {
             applyErr(binOp, rand_l, rand_r);
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
     else if (binOpStr == "*")
@@ -610,7 +858,7 @@ shared_ptr<STNode> apply(shared_ptr<BinaryOperator> binOp, shared_ptr<STNode> ra
         else
         {
             applyErr(binOp, rand_l, rand_r);
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
     else if (binOpStr == "/")
@@ -622,7 +870,7 @@ shared_ptr<STNode> apply(shared_ptr<BinaryOperator> binOp, shared_ptr<STNode> ra
         else
         {
             applyErr(binOp, rand_l, rand_r);
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
     else if (binOpStr == "**")
@@ -634,7 +882,7 @@ shared_ptr<STNode> apply(shared_ptr<BinaryOperator> binOp, shared_ptr<STNode> ra
         else
         {
             applyErr(binOp, rand_l, rand_r);
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
     else if (binOpStr == "aug")
@@ -647,7 +895,7 @@ shared_ptr<STNode> apply(shared_ptr<BinaryOperator> binOp, shared_ptr<STNode> ra
         else
         {
             applyErr(binOp, rand_l, rand_r);
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
     else if (binOpStr == "or")
@@ -659,7 +907,7 @@ shared_ptr<STNode> apply(shared_ptr<BinaryOperator> binOp, shared_ptr<STNode> ra
         else
         {
             applyErr(binOp, rand_l, rand_r);
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
     else if (binOpStr == "&")
@@ -671,7 +919,7 @@ shared_ptr<STNode> apply(shared_ptr<BinaryOperator> binOp, shared_ptr<STNode> ra
         else
         {
             applyErr(binOp, rand_l, rand_r);
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
     else if (binOpStr == "gr")
@@ -687,7 +935,7 @@ shared_ptr<STNode> apply(shared_ptr<BinaryOperator> binOp, shared_ptr<STNode> ra
         else
         {
             applyErr(binOp, rand_l, rand_r);
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
     else if (binOpStr == "ls")
@@ -703,7 +951,7 @@ shared_ptr<STNode> apply(shared_ptr<BinaryOperator> binOp, shared_ptr<STNode> ra
         else
         {
             applyErr(binOp, rand_l, rand_r);
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
     else if (binOpStr == "ge")
@@ -719,7 +967,7 @@ shared_ptr<STNode> apply(shared_ptr<BinaryOperator> binOp, shared_ptr<STNode> ra
         else
         {
             applyErr(binOp, rand_l, rand_r);
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
     else if (binOpStr == "le")
@@ -735,7 +983,7 @@ shared_ptr<STNode> apply(shared_ptr<BinaryOperator> binOp, shared_ptr<STNode> ra
         else
         {
             applyErr(binOp, rand_l, rand_r);
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
     else if (binOpStr == "eq")
@@ -755,7 +1003,7 @@ shared_ptr<STNode> apply(shared_ptr<BinaryOperator> binOp, shared_ptr<STNode> ra
         else
         {
             applyErr(binOp, rand_l, rand_r);
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
     else if (binOpStr == "ne")
@@ -775,17 +1023,69 @@ shared_ptr<STNode> apply(shared_ptr<BinaryOperator> binOp, shared_ptr<STNode> ra
         else
         {
             applyErr(binOp, rand_l, rand_r);
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
     else
     {
         cerr << "Error: Unknown binary operator " << binOpStr << "\n";
-        exit(EXIT_FAILURE);
+        fail();
     }
 }
 
-shared_ptr<STNode> apply(shared_ptr<Function> op, shared_ptr<STNode> rand)
+shared_ptr<STNode> apply(int op, int rand_l, int rand_r)
+{
+    switch (op)
+    {
+    case ADD:
+        return makeNode<Integer>(rand_l + rand_r);
+    case SUBTRACT:
+        return makeNode<Integer>(rand_l - rand_r);
+    case MULTIPLY:
+        return makeNode<Integer>(rand_l * rand_r);
+    case DIVIDE:
+        return makeNode<Integer>(rand_l / rand_r);
+    case POWER:
+        return makeNode<Integer>((int)pow(rand_l, rand_r));
+    }
+
+    bool result;
+    if (compare(op, rand_l, rand_r, result))
+    {
+        return makeNode<TruthValue>(result);
+    }
+
+    return nullptr;
+}
+
+bool compare(int op, int rand_l, int rand_r, bool &result)
+{
+    switch (op)
+    {
+    case GR:
+        result = rand_l > rand_r;
+        return true;
+    case LS:
+        result = rand_l < rand_r;
+        return true;
+    case GE:
+        result = rand_l >= rand_r;
+        return true;
+    case LE:
+        result = rand_l <= rand_r;
+        return true;
+    case EQ:
+        result = rand_l == rand_r;
+        return true;
+    case NE:
+        result = rand_l != rand_r;
+        return true;
+    }
+
+    return false;
+}
+
+shared_ptr<STNode> apply(shared_ptr<Function> op, shared_ptr<STNode> rand, const function<int(int)> &numbering)
 {
     op->addArgument(rand);
 
@@ -800,9 +1100,9 @@ shared_ptr<STNode> apply(shared_ptr<Function> op, shared_ptr<STNode> rand)
 
     if (opStr == "Print")
     {
-        rands[0]->print(); // Print the value of the argument
+        rands[0]->print(numbering); // Print the value of the argument
         cout << "\n";
-        return make_shared<Dummy>();
+        return makeNode<Dummy>();
     }
 
     if (opStr == "Stern")
@@ -814,7 +1114,7 @@ shared_ptr<STNode> apply(shared_ptr<Function> op, shared_ptr<STNode> rand)
         else
         {
             cerr << "Stern: Argument is not a string\n";
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
 
@@ -827,7 +1127,7 @@ shared_ptr<STNode> apply(shared_ptr<Function> op, shared_ptr<STNode> rand)
         else
         {
             cerr << "Stem: Argument is not a string\n";
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
 
@@ -840,7 +1140,7 @@ shared_ptr<STNode> apply(shared_ptr<Function> op, shared_ptr<STNode> rand)
         else
         {
             cerr << "Conc: Arguments are not strings\n";
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
 
@@ -848,12 +1148,12 @@ shared_ptr<STNode> apply(shared_ptr<Function> op, shared_ptr<STNode> rand)
     {
         if (rands[0]->getType() == "Tuple")
         {
-            return make_shared<Integer>(dynamic_pointer_cast<Tuple>(rands[0])->getOrder());
+            return makeNode<Integer>(dynamic_pointer_cast<Tuple>(rands[0])->getOrder());
         }
         else
         {
             cerr << "Order: Argument is not a tuple\n";
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
 
@@ -861,12 +1161,12 @@ shared_ptr<STNode> apply(shared_ptr<Function> op, shared_ptr<STNode> rand)
     {
         if (rands[0]->getType() == "Tuple")
         {
-            return make_shared<TruthValue>(dynamic_pointer_cast<Tuple>(rands[0])->getOrder() == 0);
+            return makeNode<TruthValue>(dynamic_pointer_cast<Tuple>(rands[0])->getOrder() == 0);
         }
         else
         {
             cerr << "Null: Argument is not a tuple\n";
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
 
@@ -874,11 +1174,11 @@ shared_ptr<STNode> apply(shared_ptr<Function> op, shared_ptr<STNode> rand)
     {
         if (rands[0]->getType() == "Integer")
         {
-            return make_shared<TruthValue>(true);
+            return makeNode<TruthValue>(true);
         }
         else
         {
-            return make_shared<TruthValue>(false);
+            return makeNode<TruthValue>(false);
         }
     }
 
@@ -886,11 +1186,11 @@ shared_ptr<STNode> apply(shared_ptr<Function> op, shared_ptr<STNode> rand)
     {
         if (rands[0]->getType() == "String")
         {
-            return make_shared<TruthValue>(true);
+            return makeNode<TruthValue>(true);
         }
         else
         {
-            return make_shared<TruthValue>(false);
+            return makeNode<TruthValue>(false);
         }
     }
 
@@ -898,11 +1198,11 @@ shared_ptr<STNode> apply(shared_ptr<Function> op, shared_ptr<STNode> rand)
     {
         if (rands[0]->getType() == "TruthValue")
         {
-            return make_shared<TruthValue>(true);
+            return makeNode<TruthValue>(true);
         }
         else
         {
-            return make_shared<TruthValue>(false);
+            return makeNode<TruthValue>(false);
         }
     }
 
@@ -911,11 +1211,11 @@ shared_ptr<STNode> apply(shared_ptr<Function> op, shared_ptr<STNode> rand)
         string type = rands[0]->getType();
         if (type == "Function" || type == "UnaryOperator" || type == "BinaryOperator" || type == "Lambda")
         {
-            return make_shared<TruthValue>(true);
+            return makeNode<TruthValue>(true);
         }
         else
         {
-            return make_shared<TruthValue>(false);
+            return makeNode<TruthValue>(false);
         }
     }
 
@@ -923,11 +1223,11 @@ shared_ptr<STNode> apply(shared_ptr<Function> op, shared_ptr<STNode> rand)
     {
         if (rands[0]->getType() == "Tuple")
         {
-            return make_shared<TruthValue>(true);
+            return makeNode<TruthValue>(true);
         }
         else
         {
-            return make_shared<TruthValue>(false);
+            return makeNode<TruthValue>(false);
         }
     }
 
@@ -935,12 +1235,12 @@ shared_ptr<STNode> apply(shared_ptr<Function> op, shared_ptr<STNode> rand)
     {
         if (rands[0]->getType() == "Dummy")
         {
-            return make_shared<TruthValue>(true);
+            return makeNode<TruthValue>(true);
         }
         else
         {
             cerr << "Isempty: Argument is not a tuple\n";
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
 
@@ -948,17 +1248,17 @@ shared_ptr<STNode> apply(shared_ptr<Function> op, shared_ptr<STNode> rand)
     {
         if (rands[0]->getType() == "Integer")
         {
-            return make_shared<String>(to_string(dynamic_pointer_cast<Integer>(rands[0])->getValue()));
+            return makeNode<String>(to_string(dynamic_pointer_cast<Integer>(rands[0])->getValue()));
         }
         else
         {
             cerr << "ItoS: Argument is not an integer\n";
-            exit(EXIT_FAILURE);
+            fail();
         }
     }
 
     cerr << "Error: Unknown function " << opStr << "\n";
-    exit(EXIT_FAILURE);
+    fail();
 }
 
 void applyErr(shared_ptr<UnaryOperator> unOp, shared_ptr<STNode> rand)
@@ -974,5 +1274,42 @@ void applyErr(shared_ptr<BinaryOperator> binOp, shared_ptr<STNode> rand_l, share
 void stackUflowErr()
 {
     cerr << "Error: Stack underflow\n";
+    fail();
+}
+
+void fail()
+{
+    if (activeRecorder != nullptr)
+    {
+        ofstream out("flight.txt");
+        activeRecorder->dump(out, *activeProgram);
+        cerr << "The last steps of the CSE machine were written to flight.txt\n";
+    }
+    if (activeTracer != nullptr)
+        activeTracer->flush();
+    if (activeMemory != nullptr)
+        activeMemory->printPeak(cerr);
+    if (Timeline::active != nullptr)
+        Timeline::active->close();
     exit(EXIT_FAILURE);
 }
+
+shared_ptr<STNode> lookupIdentifier(shared_ptr<STNode> identifier, shared_ptr<Environment> env)
+{
+    string name = static_pointer_cast<Identifier>(identifier)->getName(); // name of the identifier
+    shared_ptr<STNode> value = lookup(name, env);                          // get the value of the identifier from the environment
+
+    if (value == nullptr)
+    {
+        // The identifier is not defined in the current environment, a parent environment of it, or the primitive environment
+        cerr << "Error: Identifier " << name << " is not defined.\n";
+        fail();
+    }
+    else if (value->getType() == "Function")
+    {
+        // The identifier is a built-in function; Therefore, take a copy
+        value = dynamic_pointer_cast<Function>(value)->getCopy();
+    }
+
+    return value;
+}
@@ -2,6 +2,8 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include "allocation.h"
 #include "environment.h"
 #include "st_types.h"
 
@@ -19,6 +21,17 @@ Environment::Environment()
     }
 }
 
+Environment::~Environment()
+{
+    // Release a chain of environments held only by each other one at a time instead of recursively
+    shared_ptr<Environment> env = move(parent);
+    while (env != nullptr && env.use_count() == 1)
+    {
+        shared_ptr<Environment> next = move(env->parent);
+        env = move(next);
+    }
+}
+
 int Environment::getIndex() const
 {
     return index;
@@ -67,33 +80,31 @@ string Environment::getType() const
 void setupPrimitiveEnvironment(unordered_map<string, shared_ptr<STNode>> &primitiveEnvironment)
 {
     // insert the built-in functions to the primitive environment
-    primitiveEnvironment.insert({"Print", make_shared<Function>("Print", 1)});
-    primitiveEnvironment.insert({"Stern", make_shared<Function>("Stern", 1)});
-    primitiveEnvironment.insert({"Stem", make_shared<Function>("Stem", 1)});
-    primitiveEnvironment.insert({"Conc", make_shared<Function>("Conc", 2)});
-    primitiveEnvironment.insert({"Order", make_shared<Function>("Order", 1)});
-    primitiveEnvironment.insert({"Null", make_shared<Function>("Null", 1)});
-    primitiveEnvironment.insert({"Isinteger", make_shared<Function>("Isinteger", 1)});
-    primitiveEnvironment.insert({"Isstring", make_shared<Function>("Isstring", 1)});
-    primitiveEnvironment.insert({"Istruthvalue", make_shared<Function>("Istruthvalue", 1)});
-    primitiveEnvironment.insert({"Isfunction", make_shared<Function>("Isfunction", 1)});
-    primitiveEnvironment.insert({"Istuple", make_shared<Function>("Istuple", 1)});
-    primitiveEnvironment.insert({"Isdummy", make_shared<Function>("Isdummy", 1)});
-    primitiveEnvironment.insert({"ItoS", make_shared<Function>("ItoS", 1)});
+    primitiveEnvironment.insert({"Print", makeNode<Function>("Print", 1)});
+    primitiveEnvironment.insert({"Stern", makeNode<Function>("Stern", 1)});
+    primitiveEnvironment.insert({"Stem", makeNode<Function>("Stem", 1)});
+    primitiveEnvironment.insert({"Conc", makeNode<Function>("Conc", 2)});
+    primitiveEnvironment.insert({"Order", makeNode<Function>("Order", 1)});
+    primitiveEnvironment.insert({"Null", makeNode<Function>("Null", 1)});
+    primitiveEnvironment.insert({"Isinteger", makeNode<Function>("Isinteger", 1)});
+    primitiveEnvironment.insert({"Isstring", makeNode<Function>("Isstring", 1)});
+    primitiveEnvironment.insert({"Istruthvalue", makeNode<Function>("Istruthvalue", 1)});
+    primitiveEnvironment.insert({"Isfunction", makeNode<Function>("Isfunction", 1)});
+    primitiveEnvironment.insert({"Istuple", makeNode<Function>("Istuple", 1)});
+    primitiveEnvironment.insert({"Isdummy", makeNode<Function>("Isdummy", 1)});
+    primitiveEnvironment.insert({"ItoS", makeNode<Function>("ItoS", 1)});
 }
 
 shared_ptr<STNode> lookup(string name, shared_ptr<Environment> env)
 {
-    if (env == nullptr)
-    {
-        return nullptr; // identifier not found
-    }
-
-    shared_ptr<STNode> val = env->getVariable(name);
-    if (val != nullptr)
+    for (; env != nullptr; env = env->getParent())
     {
-        return val; // identifier found in env
+        shared_ptr<STNode> val = env->getVariable(name);
+        if (val != nullptr)
+        {
+            return val; // identifier found in env
+        }
     }
 
-    return lookup(name, env->getParent()); // identifier not found in env, look in parent
+    return nullptr; // identifier not found
 }
@@ -10,6 +10,7 @@ class Environment : public STNode
 {
 public:
     Environment();
+    ~Environment();
 
     /**
      * @brief Get the index of the environment
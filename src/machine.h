@@ -0,0 +1,73 @@
+#ifndef MACHINE_H
+#define MACHINE_H
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "program.h"
+#include "st_types.h"
+
+/**
+ * The stack of the CSE machine. It remembers the lowest size it had since the last reset, so the items a step popped
+ * and pushed can be told apart without copying the stack. The methods are defined here to keep the machine loop inlined.
+ */
+class MachineStack
+{
+public:
+    void push_back(std::shared_ptr<STNode> node)
+    {
+        items.push_back(std::move(node));
+    }
+
+    void pop_back()
+    {
+        items.pop_back();
+        if (items.size() < low)
+            low = items.size();
+    }
+
+    const std::shared_ptr<STNode> &operator[](std::size_t index) const
+    {
+        return items[index];
+    }
+
+    std::size_t size() const
+    {
+        return items.size();
+    }
+
+    /**
+     * @brief Get the lowest size of the stack since the last reset
+     * @return The lowest size
+     */
+    std::size_t getLow() const
+    {
+        return low;
+    }
+
+    /**
+     * @brief Start tracking the lowest size from the current size
+     */
+    void resetLow()
+    {
+        low = items.size();
+    }
+
+private:
+    std::vector<std::shared_ptr<STNode>> items;
+    std::size_t low = 0;
+};
+
+// The state of the CSE machine as seen by the tracers
+struct MachineState
+{
+    long step;                            // number of the current step, from 1
+    const std::vector<Instruction> &control; // the control; the next instruction is on top before the step is executed
+    const MachineStack &stack;
+    const Program &program;
+    int environment; // index of the current environment
+    int delta;       // index of the delta of the next instruction, -1 if the machine placed it
+};
+
+#endif // MACHINE_H
@@ -1,34 +1,54 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
 #include <iostream>
-#include <fstream>
+#include <memory>
+#include <set>
 #include <string>
-#include <vector>
+#include "allocation.h"
 #include "ast.h"
+#include "cache.h"
+#include "output.h"
+#include "source.h"
+#include "stats.h"
+#include "timeline.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
 
 using namespace std;
 
 /**
- * @brief Get the tokens from the input file
- * @param filename The name of the input file
- * @return A vector of tokens
+ * @brief Parse a comma separated list of numbers given with an argument
+ * @param str The list
+ * @param numbers The set to add the numbers to
+ * @return true if the list is valid, false otherwise
  */
-vector<string> getTokens(string filename);
+bool parseNumbers(const string &str, set<int> &numbers);
 
 /**
- * @brief Remove the trailing spaces from a string
- * @param str The string to remove the leading and trailing spaces from
- * @return The string without leading and trailing spaces
+ * @brief Parse a number given with an argument
+ * @param str The number, in decimal and without a sign
+ * @param number Set to the number
+ * @return true if the number is valid and fits in a long, false otherwise
  */
-string trim(const string &str);
+bool parseNumber(const string &str, long &number);
 
 int main(int argc, char *argv[])
 {
+    static OutputBuffer output; // all output to cout is buffered until it fills or the program exits
+
     if (argc < 2)
     {
         cerr << "No input file specified\n";
         return 1;
     }
 
-    if (argc > 6)
+    if (argc > 21)
     {
         cerr << "Too many arguments\n";
         return 1;
@@ -36,8 +56,16 @@ int main(int argc, char *argv[])
 
     bool printAST = false;
     bool printST = false;
-    bool printCS = false;
-    bool printExe = false;
+    ExecutionOptions options;
+    bool binaryAST = false;
+    bool dumpBinaryAST = false;
+    string cacheDirectory; // directory of the compiled program cache, empty when it is not used
+    unique_ptr<Statistics> stats; // counters of -stats, only allocated when they are printed
+    bool statsJSON = false;
+    unique_ptr<AllocationProfile> allocations; // counters of -alloc, also kept for -memory
+    bool printAllocations = false;
+    unique_ptr<Timeline> timeline;             // timeline of -timeline
+    auto start = chrono::steady_clock::now();
 
     for (int i = 1; i < argc - 1; ++i)
     {
@@ -52,11 +80,141 @@ int main(int argc, char *argv[])
         }
         else if (arg == "-cs")
         {
-            printCS = true;
+            options.printCS = true;
         }
         else if (arg == "-exe")
         {
-            printExe = true;
+            options.printExe = true;
+        }
+        else if (arg == "-exe-compact")
+        {
+            options.compactTrace = 10000;
+        }
+        else if (arg.rfind("-exe-compact=", 0) == 0)
+        {
+            options.compactTrace = atol(arg.c_str() + 13);
+            if (options.compactTrace <= 0)
+            {
+                cerr << "Invalid argument: " << arg << "\n";
+                return 1;
+            }
+        }
+        else if (arg.rfind("-exe-deltas=", 0) == 0)
+        {
+            options.printExe = true;
+            if (!parseNumbers(arg.substr(12), options.traceDeltas))
+            {
+                cerr << "Invalid argument: " << arg << "\n";
+                return 1;
+            }
+        }
+        else if (arg.rfind("-exe-rules=", 0) == 0)
+        {
+            options.printExe = true;
+            if (!parseNumbers(arg.substr(11), options.traceRules))
+            {
+                cerr << "Invalid argument: " << arg << "\n";
+                return 1;
+            }
+        }
+        else if (arg.rfind("-exe-every=", 0) == 0)
+        {
+            options.printExe = true;
+            if (!parseNumber(arg.substr(11), options.traceEvery) || options.traceEvery == 0)
+            {
+                cerr << "Invalid argument: " << arg << "\n";
+                return 1;
+            }
+        }
+        else if (arg.rfind("-exe-steps=", 0) == 0)
+        {
+            // A..B, where either end can be left out
+            options.printExe = true;
+            string range = arg.substr(11);
+            size_t dots = range.find("..");
+            if (dots == string::npos || (dots > 0 && !parseNumber(range.substr(0, dots), options.traceFrom)) ||
+                (dots + 2 < range.length() && !parseNumber(range.substr(dots + 2), options.traceTo)))
+            {
+                cerr << "Invalid argument: " << arg << "\n";
+                return 1;
+            }
+        }
+        else if (arg == "-exe-bin")
+        {
+            options.binaryTrace = true;
+        }
+        else if (arg == "-checked")
+        {
+            options.checked = true;
+        }
+        else if (arg == "-ast-bin")
+        {
+            binaryAST = true;
+        }
+        else if (arg == "-dump-ast-bin")
+        {
+            dumpBinaryAST = true;
+        }
+        else if (arg == "-cache")
+        {
+            cacheDirectory = getDefaultCacheDirectory();
+        }
+        else if (arg.rfind("-cache-dir=", 0) == 0)
+        {
+            cacheDirectory = arg.substr(11);
+            if (cacheDirectory.empty())
+            {
+                cerr << "Invalid argument: " << arg << "\n";
+                return 1;
+            }
+        }
+        else if (arg == "-coverage")
+        {
+            options.coverage = true;
+        }
+        else if (arg == "-profile")
+        {
+            options.profileInterval = 100;
+        }
+        else if (arg.rfind("-profile=", 0) == 0)
+        {
+            if (!parseNumber(arg.substr(9), options.profileInterval) || options.profileInterval == 0)
+            {
+                cerr << "Invalid argument: " << arg << "\n";
+                return 1;
+            }
+        }
+        else if (arg == "-alloc")
+        {
+            printAllocations = true;
+        }
+        else if (arg == "-memory")
+        {
+            options.memoryInterval = 10000;
+        }
+        else if (arg.rfind("-memory=", 0) == 0)
+        {
+            if (!parseNumber(arg.substr(8), options.memoryInterval) || options.memoryInterval == 0)
+            {
+                cerr << "Invalid argument: " << arg << "\n";
+                return 1;
+            }
+        }
+        else if (arg == "-timeline" || arg.rfind("-timeline=", 0) == 0)
+        {
+            long threshold = 1000;
+            if (arg != "-timeline" && !parseNumber(arg.substr(10), threshold))
+            {
+                cerr << "Invalid argument: " << arg << "\n";
+                return 1;
+            }
+            timeline = make_unique<Timeline>("timeline.json", threshold);
+            Timeline::active = timeline.get();
+        }
+        else if (arg == "-stats" || arg == "-stats=text" || arg == "-stats=json")
+        {
+            stats = make_unique<Statistics>();
+            statsJSON = arg == "-stats=json";
         }
         else
         {
@@ -65,50 +223,128 @@ int main(int argc, char *argv[])
         }
     }
 
+    // A run writes a single trace of the Execution
+    if (options.printExe && options.compactTrace > 0)
+    {
+        cerr << "Invalid argument: -exe-compact cannot be combined with -exe\n";
+        return 1;
+    }
+    if (options.binaryTrace && (options.printExe || options.compactTrace > 0))
+    {
+        cerr << "Invalid argument: -exe-bin cannot be combined with -exe or -exe-compact\n";
+        return 1;
+    }
+
+    // The memory profile counts the live nodes with the allocation profile
+    if (printAllocations || options.memoryInterval > 0)
+    {
+        allocations = make_unique<AllocationProfile>();
+        AllocationProfile::active = allocations.get();
+    }
+
+    // Print the statistics and the allocations to stderr once the program has run
+    auto report = [&]()
+    {
+        if (stats != nullptr)
+            stats->print(cerr, statsJSON, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+        if (printAllocations)
+            allocations->print(cerr);
+        AllocationProfile::active = nullptr; // the nodes released from here on were counted as live
+    };
+
+    PhaseTimer loading(stats.get(), Statistics::LOAD);
     string filename(argv[argc - 1]);
-    vector<string> tokens = getTokens(filename);
+    SourceFile source(filename);
+    if (!source.isOpen())
+    {
+        cerr << "File not found: " + filename << "\n";
+        exit(EXIT_FAILURE);
+    }
+
+    // The trees are only built when they are printed and the traces need unfused code; otherwise the compiled program
+    // of an earlier run can be used
+    unique_ptr<ProgramCache> cache;
+    if (!cacheDirectory.empty() && !printAST && !printST && !dumpBinaryAST && !options.printExe &&
+        options.compactTrace == 0 && !options.binaryTrace)
+        cache = make_unique<ProgramCache>(cacheDirectory, source.getContent(), binaryAST);
+
+    shared_ptr<ST> st = cache != nullptr ? cache->load() : nullptr;
+    loading.stop();
+    if (st != nullptr)
+    {
+        st->setStatistics(stats.get());
+        st->execute(options);
+        report();
+        return 0;
+    }
+
+    unique_ptr<ASTReader> reader;
+    if (binaryAST)
+        reader = make_unique<BinaryASTReader>(source);
+    else
+        reader = make_unique<TextASTReader>(source);
+
+    if (dumpBinaryAST)
+    {
+        // Convert the AST to the binary format without running it
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        AST::dumpBinary(*reader, cout);
+        return 0;
+    }
 
-    shared_ptr<AST> ast = AST::createAST(tokens);
     if (printAST)
+    {
+        PhaseTimer building(stats.get(), Statistics::AST);
+        shared_ptr<AST> ast = AST::createAST(*reader);
+        building.stop();
         cout << *ast << "\n";
+        PhaseTimer standardizing(stats.get(), Statistics::STANDARDIZE);
+        st = ast->standardize();
+    }
+    else
+    {
+        // The AST is only needed for printing; otherwise standardize the nodes as they are read
+        PhaseTimer standardizing(stats.get(), Statistics::STANDARDIZE);
+        st = AST::streamStandardize(*reader);
+    }
+    st->setStatistics(stats.get());
 
-    shared_ptr<ST> st = ast->standardize();
     if (printST)
         cout << *st << "\n";
 
-    st->execute(printCS, printExe);
+    // The image is stored once the program has run, so that the control structures are still generated lazily
+    st->execute(options);
+    if (cache != nullptr)
+        cache->store(*st);
+    report();
     return 0;
 }
 
-vector<string> getTokens(string filename)
+bool parseNumbers(const string &str, set<int> &numbers)
 {
-    vector<string> content;
-    ifstream _file(filename);
-
-    if (!_file)
+    size_t start = 0;
+    while (start <= str.length())
     {
-        cerr << "File not found: " + filename << "\n";
-        exit(EXIT_FAILURE);
-    }
-
-    // Read the file line by line
-    for (string line; getline(_file, line);)
-        content.push_back(trim(line));
+        size_t end = min(str.find(',', start), str.length());
+        long number;
+        if (!parseNumber(str.substr(start, end - start), number) || number > INT_MAX)
+            return false;
 
-    _file.close();
-    return content;
+        numbers.insert(number);
+        start = end + 1;
+    }
+    return true;
 }
 
-string trim(const string &str)
+bool parseNumber(const string &str, long &number)
 {
-    // Remove the leading spaces
-    const auto strBegin = str.find_first_not_of(" ");
-    if (strBegin == string::npos)
-        return ""; // no content
-
-    // Remove the trailing spaces
-    const auto strEnd = str.find_last_not_of(" ");
-    const auto strRange = strEnd - strBegin + 1;
+    // strtol would also take leading spaces and a sign
+    if (str.empty() || str.find_first_not_of("0123456789") != string::npos)
+        return false;
 
-    return str.substr(strBegin, strRange);
+    errno = 0;
+    number = strtol(str.c_str(), nullptr, 10);
+    return errno != ERANGE;
 }
@@ -0,0 +1,118 @@
+#include <iomanip>
+#include <string>
+#include "environment.h"
+#include "memory.h"
+#include "profile.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/**
+ * @brief Read the resident set size of the process, which also counts the storage owned by the nodes and the containers
+ * of the machine
+ * @return The resident bytes, or -1 if the system does not report them
+ */
+static long residentBytes()
+{
+#ifndef _WIN32
+    // The second field is the number of resident pages
+    ifstream statm("/proc/self/statm");
+    long size, resident;
+    if (statm >> size >> resident)
+    {
+        return resident * sysconf(_SC_PAGESIZE);
+    }
+#endif
+    return -1;
+}
+
+MemoryProfiler::MemoryProfiler(string filename, long interval, const AllocationProfile &allocations)
+    : out(filename), allocations(allocations)
+{
+    this->interval = interval;
+    this->untilSample = interval;
+    this->start = chrono::steady_clock::now();
+    out << "step,time_ms,control,stack,environments,live_bytes,rss_bytes\n";
+}
+
+void MemoryProfiler::enter(const Lambda &l, int number)
+{
+    if (number >= (int)labels.size())
+        labels.resize(number + 1);
+    if (labels[number].empty())
+        labels[number] = getFunctionLabel(l, number);
+    frames.push_back(number);
+}
+
+void MemoryProfiler::leave()
+{
+    // The primitive environment is exited last, without a call
+    if (!frames.empty())
+        frames.pop_back();
+}
+
+void MemoryProfiler::sample(const MachineState &state)
+{
+    Sample sample = measure(state);
+    if (sample.bytes > peak.bytes)
+    {
+        peak = sample;
+        peakFrames = frames;
+    }
+}
+
+void MemoryProfiler::finish(const MachineState &state)
+{
+    measure(state);
+}
+
+MemoryProfiler::Sample MemoryProfiler::measure(const MachineState &state)
+{
+    Sample sample;
+    sample.step = state.step;
+    sample.time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    sample.control = state.control.size();
+    sample.stack = state.stack.size();
+    sample.environments = allocations.getLive(getNodeType<Environment>());
+    sample.bytes = allocations.getLiveBytes();
+    sample.resident = residentBytes();
+
+    // Flushed on every sample, so the file shows how the memory grew when the run is killed
+    out << sample.step << "," << fixed << setprecision(3) << sample.time << "," << sample.control << "," << sample.stack
+        << "," << sample.environments << "," << sample.bytes << ",";
+    if (sample.resident >= 0)
+        out << sample.resident;
+    out << endl;
+    return sample;
+}
+
+void MemoryProfiler::printPeak(ostream &os) const
+{
+    if (peak.step == 0)
+    {
+        os << "Memory peak: no samples while running\n";
+        return;
+    }
+
+    os << "Memory peak at step " << peak.step << " (" << fixed << setprecision(3) << peak.time << " ms): " << peak.bytes
+       << " bytes in live nodes, " << peak.environments << " environments, " << peak.control << " on the control, "
+       << peak.stack << " on the stack";
+    if (peak.resident >= 0)
+        os << ", " << peak.resident << " bytes resident";
+    os << "\n";
+
+    // Recursive calls are collapsed into one line with their count
+    os << "Running functions, the innermost first:\n";
+    for (int i = peakFrames.size() - 1; i >= 0;)
+    {
+        int j = i;
+        while (j >= 0 && peakFrames[j] == peakFrames[i])
+            --j;
+        os << setw(8) << i - j << "  " << labels[peakFrames[i]] << "\n";
+        i = j;
+    }
+    os << setw(8) << 1 << "  main\n";
+}
@@ -0,0 +1,106 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "allocation.h"
+#include "machine.h"
+#include "st_types.h"
+
+/**
+ * Records the memory held by the machine every few steps: the sizes of the control and the stack, the environments
+ * alive, the bytes of all the nodes alive, as counted by an allocation profile, and the resident set size of the
+ * process, which also counts the storage owned by the nodes. Each sample is written to a CSV file as it is taken, so
+ * the file is kept up to date even if the process is killed. The running RPAL functions are followed as by the
+ * Profiler, so the call chain of the sample holding the most bytes can be shown at the end.
+ */
+class MemoryProfiler
+{
+public:
+    /**
+     * @brief Create a memory profiler
+     * @param filename The name of the CSV file to write
+     * @param interval The number of steps between samples
+     * @param allocations The allocation profile counting the nodes alive; it must be active
+     */
+    MemoryProfiler(std::string filename, long interval, const AllocationProfile &allocations);
+
+    /**
+     * @brief Record that a function was entered
+     * @param l The applied lambda
+     * @param number The index of the lambda in a full generation of the control structures
+     */
+    void enter(const Lambda &l, int number);
+
+    /**
+     * @brief Record that the current function was exited
+     */
+    void leave();
+
+    /**
+     * @brief Count a step, taking a sample when it is due
+     * @param state The state of the machine before the step
+     */
+    void step(const MachineState &state)
+    {
+        if (--untilSample == 0)
+        {
+            sample(state);
+            untilSample = interval;
+        }
+    }
+
+    /**
+     * @brief Take a sample
+     * @param state The state of the machine
+     */
+    void sample(const MachineState &state);
+
+    /**
+     * @brief Write a last sample once the machine stopped; it is not a candidate for the peak, as no function runs
+     * @param state The state of the machine
+     */
+    void finish(const MachineState &state);
+
+    /**
+     * @brief Print the sample holding the most bytes and the functions running at that point
+     * @param os The output stream to print to
+     */
+    void printPeak(std::ostream &os) const;
+
+private:
+    // A sample of the memory held by the machine
+    struct Sample
+    {
+        long step = 0;
+        double time = 0; // milliseconds since the machine started
+        std::size_t control = 0;
+        std::size_t stack = 0;
+        long environments = 0;
+        long bytes = 0;
+        long resident = -1; // resident set size of the process, -1 if unknown
+    };
+
+    std::ofstream out;
+    long interval;
+    long untilSample; // steps until the next sample
+    const AllocationProfile &allocations;
+    std::chrono::steady_clock::time_point start;
+    std::vector<std::string> labels; // label of each entered lambda, by its number in a full generation
+    std::vector<int> frames;         // numbers of the lambdas of the running functions, the outermost first
+    Sample peak;                     // the sample holding the most bytes
+    std::vector<int> peakFrames;     // the running functions at the peak
+
+    /**
+     * @brief Measure the memory held by the machine and write it to the file
+     * @param state The state of the machine
+     * @return The sample
+     */
+    Sample measure(const MachineState &state);
+};
+
+#endif // MEMORY_H
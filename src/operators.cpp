@@ -19,13 +19,23 @@ bool isUnOp(string op)
 }
 
 bool isBinOp(string op)
+{
+    return getBinOpCode(op) >= 0;
+}
+
+int getBinOpCode(string op)
 {
     for (int i = 0; i < 14; ++i)
     {
         if (op == binOps[i])
         {
-            return true;
+            return i;
         }
     }
-    return false;
+    return -1;
+}
+
+string getBinOpName(int code)
+{
+    return binOps[code];
 }
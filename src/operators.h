@@ -3,6 +3,25 @@
 
 #include <iostream>
 
+// Binary operators in the order of their codes
+enum BinaryOperation
+{
+    ADD,
+    SUBTRACT,
+    MULTIPLY,
+    DIVIDE,
+    POWER,
+    AUG,
+    OR,
+    AND,
+    GR,
+    LS,
+    GE,
+    LE,
+    EQ,
+    NE,
+};
+
 /**
  * @brief Identify whether a unary operator by name
  * @param op The name of the operator
@@ -17,4 +36,18 @@ bool isUnOp(std::string op);
  */
 bool isBinOp(std::string op);
 
+/**
+ * @brief Get the code of a binary operator
+ * @param op The name of the operator
+ * @return The code of the operator, -1 if the name does not refer to a binary operator
+ */
+int getBinOpCode(std::string op);
+
+/**
+ * @brief Get the name of a binary operator
+ * @param code The code of the operator
+ * @return The name of the operator
+ */
+std::string getBinOpName(int code);
+
 #endif // OPERATORS_H
@@ -0,0 +1,69 @@
+#include <cstdio>
+#include <iostream>
+#include "output.h"
+
+using namespace std;
+
+OutputBuffer::OutputBuffer(size_t capacity) : buffer(capacity)
+{
+    setp(buffer.data(), buffer.data() + buffer.size());
+    previous = cout.rdbuf(this);
+}
+
+OutputBuffer::~OutputBuffer()
+{
+    writeOut();
+    fflush(stdout);
+    cout.rdbuf(previous);
+}
+
+OutputBuffer::int_type OutputBuffer::overflow(int_type c)
+{
+    if (!writeOut())
+    {
+        return traits_type::eof();
+    }
+
+    if (!traits_type::eq_int_type(c, traits_type::eof()))
+    {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+streamsize OutputBuffer::xsputn(const char *s, streamsize n)
+{
+    if (n <= epptr() - pptr())
+    {
+        traits_type::copy(pptr(), s, n);
+        pbump(n);
+        return n;
+    }
+
+    // Too large for the space left; write the buffered output and then the run itself
+    if (!writeOut())
+    {
+        return 0;
+    }
+    if (n < epptr() - pptr())
+    {
+        traits_type::copy(pptr(), s, n);
+        pbump(n);
+        return n;
+    }
+    return fwrite(s, 1, n, stdout);
+}
+
+int OutputBuffer::sync()
+{
+    return writeOut() && fflush(stdout) == 0 ? 0 : -1;
+}
+
+bool OutputBuffer::writeOut()
+{
+    size_t length = pptr() - pbase();
+    bool written = length == 0 || fwrite(pbase(), 1, length, stdout) == length;
+    setp(buffer.data(), buffer.data() + buffer.size());
+    return written;
+}
@@ -0,0 +1,39 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <cstddef>
+#include <iostream>
+#include <streambuf>
+#include <vector>
+
+class OutputBuffer : public std::streambuf
+{
+public:
+    /**
+     * @brief Route the standard output through a large buffer while the buffer exists; the buffer is written out when it
+     *        fills, when cout is flushed (also before anything is written to cerr), and when it is destroyed at exit
+     * @param capacity The size of the buffer in bytes
+     */
+    OutputBuffer(std::size_t capacity = 1 << 20);
+    ~OutputBuffer();
+
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+protected:
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char *s, std::streamsize n) override;
+    int sync() override;
+
+private:
+    std::vector<char> buffer;
+    std::streambuf *previous; // the buffer of cout before it was replaced
+
+    /**
+     * @brief Write the buffered output to the standard output
+     * @return true on success, false otherwise
+     */
+    bool writeOut();
+};
+
+#endif // OUTPUT_H
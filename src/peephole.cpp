@@ -0,0 +1,52 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "allocation.h"
+#include "st.h"
+
+using namespace std;
+
+void ST::fuse(vector<shared_ptr<STNode>> &controlStructure) const
+{
+    vector<shared_ptr<STNode>> fused;
+    int size = controlStructure.size();
+
+    int i = 0;
+    while (i < size)
+    {
+        string first = controlStructure[i]->getType();
+        string second = i + 1 < size ? controlStructure[i + 1]->getType() : "";
+        string third = i + 2 < size ? controlStructure[i + 2]->getType() : "";
+        string fourth = i + 3 < size ? controlStructure[i + 3]->getType() : "";
+
+        // The control structures are in preorder, so a leaf following an operator is a complete operand
+        if (first == "Beta" && second == "BinaryOperator" && third == "Identifier" && fourth == "Integer")
+        {
+            // The condition of a conditional compares an identifier with an integer
+            vector<shared_ptr<STNode>> nodes(controlStructure.begin() + i, controlStructure.begin() + i + 4);
+            fused.push_back(makeNode<Superinstruction>(BRANCH_INTEGER, nodes));
+            i += 4;
+        }
+        else if (first == "BinaryOperator" && second == "Identifier" && third == "Integer")
+        {
+            vector<shared_ptr<STNode>> nodes(controlStructure.begin() + i, controlStructure.begin() + i + 3);
+            fused.push_back(makeNode<Superinstruction>(OPERATE_INTEGER, nodes));
+            i += 3;
+        }
+        else if (first == "Gamma" && second == "Identifier" && third == "Identifier")
+        {
+            // Both the rator and the rand are identifiers
+            vector<shared_ptr<STNode>> nodes(controlStructure.begin() + i, controlStructure.begin() + i + 3);
+            fused.push_back(makeNode<Superinstruction>(APPLY_IDENTIFIERS, nodes));
+            i += 3;
+        }
+        else
+        {
+            fused.push_back(controlStructure[i]);
+            ++i;
+        }
+    }
+
+    controlStructure = fused;
+}
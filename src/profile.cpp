@@ -0,0 +1,77 @@
+#include <iostream>
+#include <string>
+#include "profile.h"
+
+using namespace std;
+
+string getFunctionLabel(const Lambda &l, int number)
+{
+    // Anonymous functions are labeled as in the control structures
+    string label = l.getName();
+    if (label.empty())
+    {
+        label = "lambda_" + to_string(number) + "^";
+        auto bindings = l.getBindings();
+        for (int i = 0; i < (int)bindings.size(); ++i)
+        {
+            label += (i == 0 ? "" : ",") + bindings[i]->getName();
+        }
+    }
+    return label;
+}
+
+Profiler::Profiler(long interval)
+{
+    this->interval = interval;
+    this->untilSample = interval;
+    this->labels.push_back("main"); // the program itself runs in the primitive environment
+    this->numbers.push_back(-1);
+    this->frames.push_back(0);
+}
+
+void Profiler::enter(const Lambda &l, int number)
+{
+    auto frame = numberFrames.find(number);
+    if (frame == numberFrames.end())
+    {
+        frame = numberFrames.insert({number, labels.size()}).first;
+        labels.push_back(getFunctionLabel(l, number));
+        numbers.push_back(number);
+    }
+
+    frames.push_back(frame->second);
+}
+
+void Profiler::leave()
+{
+    if (!frames.empty())
+        frames.pop_back();
+}
+
+void Profiler::write(ostream &os) const
+{
+    // Frames of functions with the same name, e.g. in different scopes, are told apart by their lambdas
+    unordered_map<string, int> uses;
+    for (const string &label : labels)
+        ++uses[label];
+    vector<string> shown = labels;
+    for (int i = 1; i < (int)shown.size(); ++i)
+    {
+        if (uses[labels[i]] > 1)
+            shown[i] += " (lambda_" + to_string(numbers[i]) + ")";
+    }
+
+    for (const auto &sample : samples)
+    {
+        for (int i = 0; i < (int)sample.first.size(); ++i)
+        {
+            os << (i == 0 ? "" : ";") << shown[sample.first[i]];
+        }
+        os << " " << sample.second << "\n";
+    }
+}
+
+void Profiler::sample()
+{
+    ++samples[frames];
+}
@@ -0,0 +1,80 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "st_types.h"
+
+/**
+ * @brief Get the label of a function in profiles: its name if it was defined with a function form or rec, otherwise its
+ *        lambda as in the control structures, e.g. lambda_3^x
+ * @param l The lambda of the function
+ * @param number The index of the lambda in a full generation of the control structures
+ * @return The label
+ */
+std::string getFunctionLabel(const Lambda &l, int number);
+
+/**
+ * Samples the RPAL functions that are running every few steps of the machine. A function runs from the step that binds
+ * its lambda until the step that exits its environment, so the running functions are kept as a stack of frames that
+ * follows the environments on the control. The samples are written in the folded format of flame graph tools: one line
+ * per distinct stack, the outermost frame first, followed by the number of samples.
+ */
+class Profiler
+{
+public:
+    /**
+     * @brief Create a profiler
+     * @param interval The number of steps between samples
+     */
+    Profiler(long interval);
+
+    /**
+     * @brief Record that a function was entered
+     * @param l The applied lambda
+     * @param number The index of the lambda in a full generation of the control structures
+     */
+    void enter(const Lambda &l, int number);
+
+    /**
+     * @brief Record that the current function was exited
+     */
+    void leave();
+
+    /**
+     * @brief Count a step, taking a sample when it is due
+     */
+    void step()
+    {
+        if (--untilSample == 0)
+        {
+            sample();
+            untilSample = interval;
+        }
+    }
+
+    /**
+     * @brief Write the samples in the folded format
+     * @param os The output stream to write to
+     */
+    void write(std::ostream &os) const;
+
+private:
+    long interval;
+    long untilSample;                        // steps until the next sample
+    std::vector<std::string> labels;           // label of each frame
+    std::vector<int> numbers;                  // number of the lambda of each frame in a full generation, -1 for main
+    std::unordered_map<int, int> numberFrames; // frame of each entered lambda, by its number in a full generation
+    std::vector<int> frames;                   // frames of the running functions, the outermost first
+    std::map<std::vector<int>, long> samples;  // number of samples of each stack of frames
+
+    /**
+     * @brief Count the current stack of frames
+     */
+    void sample();
+};
+
+#endif // PROFILE_H
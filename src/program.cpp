@@ -0,0 +1,582 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "allocation.h"
+#include "operators.h"
+#include "program.h"
+
+using namespace std;
+
+// Kinds of the constants stored in an image
+enum ConstantKind : uint8_t
+{
+    IDENTIFIER_CONSTANT,
+    INTEGER_CONSTANT,
+    STRING_CONSTANT,
+    TRUTH_VALUE_CONSTANT,
+    NIL_CONSTANT,
+    LAMBDA_CONSTANT,
+    BINARY_OPERATOR_CONSTANT,
+    UNARY_OPERATOR_CONSTANT,
+    Y_STAR_CONSTANT,
+    DUMMY_CONSTANT,
+};
+
+/**
+ * @brief Write a 32 bit number as it is laid out in memory
+ * @param os The output stream to write to
+ * @param value The number
+ */
+static void writeUint32(ostream &os, uint32_t value)
+{
+    os.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+/**
+ * @brief Write a string prefixed by its length
+ * @param os The output stream to write to
+ * @param str The string
+ */
+static void writeString(ostream &os, const string &str)
+{
+    writeUint32(os, str.length());
+    os.write(str.data(), str.length());
+}
+
+// Reads the fields of an image, failing on any read past its end
+struct ImageReader
+{
+    string_view data;
+    size_t position;
+    bool failed;
+
+    const char *take(size_t length)
+    {
+        if (failed || length > data.length() - position)
+        {
+            failed = true;
+            return nullptr;
+        }
+        const char *field = data.data() + position;
+        position += length;
+        return field;
+    }
+
+    uint32_t readUint32()
+    {
+        uint32_t value = 0;
+        const char *field = take(sizeof(value));
+        if (field != nullptr)
+            memcpy(&value, field, sizeof(value));
+        return value;
+    }
+
+    uint8_t readUint8()
+    {
+        const char *field = take(1);
+        return field != nullptr ? *field : 0;
+    }
+
+    string readString()
+    {
+        uint32_t length = readUint32();
+        const char *field = take(length);
+        return field != nullptr ? string(field, length) : "";
+    }
+};
+
+/**
+ * @brief Check that the operands of an instruction read from an image refer to what the machine expects of them
+ * @param instruction The instruction
+ * @param constants The constants of the image
+ * @param deltaCount The number of deltas of the image
+ * @return true if the instruction is valid, false otherwise
+ */
+static bool isValid(const Instruction &instruction, const vector<shared_ptr<STNode>> &constants, uint32_t deltaCount)
+{
+    auto isConstant = [&](int32_t index, const char *type)
+    { return index >= 0 && index < (int)constants.size() && constants[index]->getType() == type; };
+    auto isDelta = [&](int32_t index)
+    { return index >= 0 && (uint32_t)index < deltaCount; };
+
+    switch (instruction.opcode)
+    {
+    case OP_IDENTIFIER:
+        return isConstant(instruction.a, "Identifier");
+    case OP_CONSTANT:
+        return isConstant(instruction.a, "Integer") || isConstant(instruction.a, "String") ||
+               isConstant(instruction.a, "TruthValue") || isConstant(instruction.a, "Dummy") || isConstant(instruction.a, "YStar");
+    case OP_TUPLE:
+        return isConstant(instruction.a, "Tuple");
+    case OP_LAMBDA:
+        return isConstant(instruction.a, "Lambda");
+    case OP_GAMMA:
+        return true;
+    case OP_BINARY:
+        return isConstant(instruction.a, "BinaryOperator") && getBinOpCode(constants[instruction.a]->toString()) == instruction.op;
+    case OP_UNARY:
+        return isConstant(instruction.a, "UnaryOperator");
+    case OP_BETA:
+        return isDelta(instruction.a) && isDelta(instruction.b);
+    case OP_TAU:
+        return instruction.a >= 0;
+    case OP_APPLY_IDENTIFIERS:
+        return isConstant(instruction.a, "Identifier") && isConstant(instruction.b, "Identifier");
+    case OP_OPERATE_INTEGER:
+        return instruction.op <= NE && isConstant(instruction.a, "Identifier");
+    case OP_BRANCH_INTEGER:
+        return instruction.op <= NE && isConstant(instruction.a, "Identifier") && isDelta(instruction.c) &&
+               (uint32_t)instruction.c + 1 < deltaCount;
+    default:
+        // Environments are only placed by the machine
+        return false;
+    }
+}
+
+Program::Program()
+{
+    image = nullptr;
+}
+
+void Program::add(int index, const vector<shared_ptr<STNode>> &controlStructure)
+{
+    if (index >= (int)offsets.size())
+    {
+        offsets.resize(index + 1, -1);
+        sizes.resize(index + 1, 0);
+    }
+
+    offsets[index] = code.size();
+    for (auto node : controlStructure)
+    {
+        emit(node);
+    }
+    sizes[index] = code.size() - offsets[index];
+}
+
+bool Program::contains(int index) const
+{
+    return index < (int)offsets.size() && offsets[index] >= 0;
+}
+
+int Program::getDeltaCount() const
+{
+    return offsets.size();
+}
+
+const Instruction *Program::getCode(int index) const
+{
+    return (image != nullptr ? image : code.data()) + offsets[index];
+}
+
+int Program::getSize(int index) const
+{
+    return sizes[index];
+}
+
+const shared_ptr<STNode> &Program::getConstant(int index) const
+{
+    return constants[index];
+}
+
+string Program::toString(const Instruction &instruction) const
+{
+    switch (instruction.opcode)
+    {
+    case OP_IDENTIFIER:
+    case OP_TUPLE:
+    case OP_LAMBDA:
+    case OP_BINARY:
+    case OP_UNARY:
+        return constants[instruction.a]->toString();
+    case OP_CONSTANT:
+    {
+        shared_ptr<STNode> node = constants[instruction.a];
+        return node->getType() == "String" ? "'" + node->toString() + "'" : node->toString();
+    }
+    case OP_GAMMA:
+        return "gamma";
+    case OP_BETA:
+        return "delta_" + to_string(instruction.a) + " delta_" + to_string(instruction.b) + " beta";
+    case OP_TAU:
+        return "tau_" + to_string(instruction.a);
+    case OP_ENVIRONMENT:
+        return "e_" + to_string(instruction.a);
+    case OP_APPLY_IDENTIFIERS:
+        return "gamma " + constants[instruction.a]->toString() + " " + constants[instruction.b]->toString();
+    case OP_OPERATE_INTEGER:
+        return getBinOpName(instruction.op) + " " + constants[instruction.a]->toString() + " " + to_string(instruction.b);
+    case OP_BRANCH_INTEGER:
+        return "delta_" + to_string(instruction.c) + " delta_" + to_string(instruction.c + 1) + " beta " +
+               getBinOpName(instruction.op) + " " + constants[instruction.a]->toString() + " " + to_string(instruction.b);
+    }
+    return "";
+}
+
+bool Program::write(ostream &os, uint32_t flags, const vector<int> &numbers) const
+{
+    int deltaCount = offsets.size();
+    auto number = [&](int index)
+    { return numbers.empty() ? index : numbers[index]; };
+    if (!numbers.empty() && (int)numbers.size() != deltaCount)
+    {
+        return false;
+    }
+
+    const Instruction *instructions = image != nullptr ? image : code.data();
+    int instructionCount = 0;
+    vector<int> imageOffsets(deltaCount, -1), imageSizes(deltaCount);
+    for (int i = 0; i < deltaCount; ++i)
+    {
+        if (offsets[i] < 0 || number(i) < 0 || number(i) >= deltaCount || imageOffsets[number(i)] >= 0)
+        {
+            return false; // only fully generated programs are stored, each delta under its own index
+        }
+        instructionCount = max(instructionCount, offsets[i] + sizes[i]);
+        imageOffsets[number(i)] = offsets[i];
+        imageSizes[number(i)] = sizes[i];
+    }
+
+    // The deltas the instructions refer to are renumbered in a copy
+    vector<Instruction> renumbered;
+    if (!numbers.empty())
+    {
+        renumbered.assign(instructions, instructions + instructionCount);
+        for (Instruction &instruction : renumbered)
+        {
+            if (instruction.opcode == OP_BETA)
+            {
+                instruction.a = number(instruction.a);
+                instruction.b = number(instruction.b);
+            }
+            else if (instruction.opcode == OP_BRANCH_INTEGER)
+            {
+                // delta_else must still follow delta_then
+                if (number(instruction.c + 1) != number(instruction.c) + 1)
+                {
+                    return false;
+                }
+                instruction.c = number(instruction.c);
+            }
+        }
+        instructions = renumbered.data();
+    }
+
+    writeUint32(os, flags);
+    writeUint32(os, deltaCount);
+    writeUint32(os, instructionCount);
+    writeUint32(os, constants.size());
+    for (int offset : imageOffsets)
+    {
+        writeUint32(os, offset);
+    }
+    for (int size : imageSizes)
+    {
+        writeUint32(os, size);
+    }
+    os.write(reinterpret_cast<const char *>(instructions), instructionCount * sizeof(Instruction));
+
+    for (auto constant : constants)
+    {
+        string nodeType = constant->getType();
+        if (nodeType == "Identifier")
+        {
+            os.put(IDENTIFIER_CONSTANT);
+            writeString(os, constant->toString());
+        }
+        else if (nodeType == "Integer")
+        {
+            os.put(INTEGER_CONSTANT);
+            writeUint32(os, static_pointer_cast<Integer>(constant)->getValue());
+        }
+        else if (nodeType == "String")
+        {
+            os.put(STRING_CONSTANT);
+            writeString(os, static_pointer_cast<String>(constant)->getValue());
+        }
+        else if (nodeType == "TruthValue")
+        {
+            os.put(TRUTH_VALUE_CONSTANT);
+            os.put(static_pointer_cast<TruthValue>(constant)->getValue());
+        }
+        else if (nodeType == "Tuple" && static_pointer_cast<Tuple>(constant)->getOrder() == 0)
+        {
+            os.put(NIL_CONSTANT);
+        }
+        else if (nodeType == "Lambda")
+        {
+            shared_ptr<Lambda> l = static_pointer_cast<Lambda>(constant);
+            os.put(LAMBDA_CONSTANT);
+            writeUint32(os, number(l->getIndex()));
+            writeString(os, l->getName());
+            writeUint32(os, l->getBindingCount());
+            for (auto binding : l->getBindings())
+            {
+                writeString(os, binding->toString());
+            }
+        }
+        else if (nodeType == "BinaryOperator")
+        {
+            os.put(BINARY_OPERATOR_CONSTANT);
+            writeString(os, constant->toString());
+        }
+        else if (nodeType == "UnaryOperator")
+        {
+            os.put(UNARY_OPERATOR_CONSTANT);
+            writeString(os, constant->toString());
+        }
+        else if (nodeType == "YStar")
+        {
+            os.put(Y_STAR_CONSTANT);
+        }
+        else if (nodeType == "Dummy")
+        {
+            os.put(DUMMY_CONSTANT);
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return os.good();
+}
+
+bool Program::read(shared_ptr<SourceFile> file, size_t offset, uint32_t &flags)
+{
+    ImageReader reader = {file->getContent(), offset, false};
+    flags = reader.readUint32();
+    uint32_t deltaCount = reader.readUint32();
+    uint32_t instructionCount = reader.readUint32();
+    uint32_t constantCount = reader.readUint32();
+    if (reader.failed || deltaCount > reader.data.length() || instructionCount > reader.data.length())
+    {
+        return false;
+    }
+
+    vector<int> imageOffsets(deltaCount), imageSizes(deltaCount);
+    for (uint32_t i = 0; i < deltaCount; ++i)
+    {
+        imageOffsets[i] = reader.readUint32();
+    }
+    for (uint32_t i = 0; i < deltaCount; ++i)
+    {
+        imageSizes[i] = reader.readUint32();
+        if (imageOffsets[i] < 0 || imageSizes[i] < 0 || (uint32_t)(imageOffsets[i] + imageSizes[i]) > instructionCount)
+        {
+            return false;
+        }
+    }
+
+    const char *instructions = reader.take(instructionCount * sizeof(Instruction));
+    if (reader.failed)
+    {
+        return false;
+    }
+
+    vector<shared_ptr<STNode>> imageConstants;
+    for (uint32_t i = 0; i < constantCount && !reader.failed; ++i)
+    {
+        switch (reader.readUint8())
+        {
+        case IDENTIFIER_CONSTANT:
+            imageConstants.push_back(makeNode<Identifier>(reader.readString()));
+            break;
+        case INTEGER_CONSTANT:
+            imageConstants.push_back(makeNode<Integer>((int)reader.readUint32()));
+            break;
+        case STRING_CONSTANT:
+            imageConstants.push_back(makeNode<String>(reader.readString()));
+            break;
+        case TRUTH_VALUE_CONSTANT:
+            imageConstants.push_back(makeNode<TruthValue>(reader.readUint8() != 0));
+            break;
+        case NIL_CONSTANT:
+            imageConstants.push_back(makeNode<Tuple>());
+            break;
+        case LAMBDA_CONSTANT:
+        {
+            shared_ptr<Lambda> l = makeNode<Lambda>();
+            uint32_t index = reader.readUint32();
+            if (index >= deltaCount)
+            {
+                return false;
+            }
+            l->setIndex(index);
+            l->setName(reader.readString());
+            uint32_t bindingCount = reader.readUint32();
+            for (uint32_t j = 0; j < bindingCount && !reader.failed; ++j)
+            {
+                l->addBinding(makeNode<Identifier>(reader.readString()));
+            }
+            imageConstants.push_back(l);
+            break;
+        }
+        case BINARY_OPERATOR_CONSTANT:
+            imageConstants.push_back(makeNode<BinaryOperator>(reader.readString()));
+            break;
+        case UNARY_OPERATOR_CONSTANT:
+            imageConstants.push_back(makeNode<UnaryOperator>(reader.readString()));
+            break;
+        case Y_STAR_CONSTANT:
+            imageConstants.push_back(makeNode<YStar>());
+            break;
+        case DUMMY_CONSTANT:
+            imageConstants.push_back(makeNode<Dummy>());
+            break;
+        default:
+            return false;
+        }
+    }
+    if (reader.failed)
+    {
+        return false;
+    }
+
+    // A damaged image must not send the machine to a missing constant or delta
+    for (uint32_t i = 0; i < instructionCount; ++i)
+    {
+        Instruction instruction;
+        memcpy(&instruction, instructions + i * sizeof(Instruction), sizeof(Instruction));
+        if (!isValid(instruction, imageConstants, deltaCount))
+        {
+            return false;
+        }
+    }
+
+    // The instructions are used in place unless the mapping leaves them misaligned
+    code.clear();
+    image = nullptr;
+    if (reinterpret_cast<uintptr_t>(instructions) % alignof(Instruction) == 0)
+    {
+        image = reinterpret_cast<const Instruction *>(instructions);
+    }
+    else
+    {
+        code.resize(instructionCount);
+        memcpy(code.data(), instructions, instructionCount * sizeof(Instruction));
+    }
+
+    imageFile = file;
+    offsets = move(imageOffsets);
+    sizes = move(imageSizes);
+    constants = move(imageConstants);
+    identifiers.clear();
+    return true;
+}
+
+int Program::addConstant(shared_ptr<STNode> node)
+{
+    constants.push_back(node);
+    return constants.size() - 1;
+}
+
+int Program::addIdentifier(shared_ptr<STNode> node)
+{
+    string name = node->toString();
+    auto it = identifiers.find(name);
+    if (it != identifiers.end())
+    {
+        return it->second;
+    }
+
+    int index = addConstant(node);
+    identifiers[name] = index;
+    return index;
+}
+
+void Program::emit(shared_ptr<STNode> node)
+{
+    Instruction instruction = {OP_CONSTANT, 0, 0, 0, 0};
+    string nodeType = node->getType();
+
+    if (nodeType == "Identifier")
+    {
+        instruction.opcode = OP_IDENTIFIER;
+        instruction.a = addIdentifier(node);
+    }
+    else if (nodeType == "Tuple")
+    {
+        // Tuples are mutable by aug; the machine pushes a copy
+        instruction.opcode = OP_TUPLE;
+        instruction.a = addConstant(node);
+    }
+    else if (nodeType == "Lambda")
+    {
+        instruction.opcode = OP_LAMBDA;
+        instruction.a = addConstant(node);
+    }
+    else if (nodeType == "Gamma")
+    {
+        instruction.opcode = OP_GAMMA;
+    }
+    else if (nodeType == "BinaryOperator")
+    {
+        instruction.opcode = OP_BINARY;
+        instruction.op = getBinOpCode(node->toString());
+        instruction.a = addConstant(node);
+    }
+    else if (nodeType == "UnaryOperator")
+    {
+        instruction.opcode = OP_UNARY;
+        instruction.a = addConstant(node);
+    }
+    else if (nodeType == "Beta")
+    {
+        shared_ptr<Beta> beta = static_pointer_cast<Beta>(node);
+        instruction.opcode = OP_BETA;
+        instruction.a = beta->getThenIndex();
+        instruction.b = beta->getElseIndex();
+    }
+    else if (nodeType == "Tau")
+    {
+        instruction.opcode = OP_TAU;
+        instruction.a = static_pointer_cast<Tau>(node)->getSize();
+    }
+    else if (nodeType == "Superinstruction")
+    {
+        shared_ptr<Superinstruction> s = static_pointer_cast<Superinstruction>(node);
+        if (s->getKind() == APPLY_IDENTIFIERS)
+        {
+            instruction.opcode = OP_APPLY_IDENTIFIERS;
+            instruction.a = addIdentifier(s->getNode(1));
+            instruction.b = addIdentifier(s->getNode(2));
+        }
+        else
+        {
+            int offset = s->getKind() == BRANCH_INTEGER ? 1 : 0;
+            instruction.opcode = s->getKind() == BRANCH_INTEGER ? OP_BRANCH_INTEGER : OP_OPERATE_INTEGER;
+            instruction.op = getBinOpCode(s->getNode(offset)->toString());
+            instruction.a = addIdentifier(s->getNode(offset + 1));
+            instruction.b = static_pointer_cast<Integer>(s->getNode(offset + 2))->getValue();
+
+            if (s->getKind() == BRANCH_INTEGER)
+            {
+                shared_ptr<Beta> beta = static_pointer_cast<Beta>(s->getNode(0));
+                if (beta->getElseIndex() != beta->getThenIndex() + 1)
+                {
+                    // The record has room for delta_then only; emit the fused nodes separately
+                    for (int i = 0; i < 4; ++i)
+                    {
+                        emit(s->getNode(i));
+                    }
+                    return;
+                }
+                instruction.c = beta->getThenIndex();
+            }
+        }
+    }
+    else
+    {
+        // Values, and any other node, are pushed to the stack as they are
+        instruction.a = addConstant(node);
+    }
+
+    code.push_back(instruction);
+}
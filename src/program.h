@@ -0,0 +1,142 @@
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "source.h"
+#include "st_types.h"
+
+enum Opcode : uint8_t
+{
+    OP_IDENTIFIER,        // a: constant index of the identifier
+    OP_CONSTANT,          // a: constant index of the value
+    OP_TUPLE,             // a: constant index of the tuple; a copy is pushed
+    OP_LAMBDA,            // a: constant index of the lambda
+    OP_GAMMA,             //
+    OP_BINARY,            // op: code of the operator, a: constant index of the operator
+    OP_UNARY,             // a: constant index of the operator
+    OP_BETA,              // a: index of delta_then, b: index of delta_else
+    OP_TAU,               // a: number of elements
+    OP_ENVIRONMENT,       // a: index of the environment; only placed by the machine
+    OP_APPLY_IDENTIFIERS, // a: constant index of the rator, b: constant index of the rand
+    OP_OPERATE_INTEGER,   // op: code of the operator, a: constant index of the identifier, b: integer
+    OP_BRANCH_INTEGER,    // op: code of the operator, a: constant index of the identifier, b: integer, c: index of delta_then;
+                          // delta_else immediately follows delta_then
+};
+
+struct Instruction
+{
+    Opcode opcode;
+    uint8_t op;
+    int32_t a;
+    int32_t b;
+    int32_t c;
+};
+
+class Program
+{
+public:
+    Program();
+
+    /**
+     * @brief Append the control structure of a delta to the code
+     * @param index The index of the delta
+     * @param controlStructure The control structure of the delta
+     */
+    void add(int index, const std::vector<std::shared_ptr<STNode>> &controlStructure);
+
+    /**
+     * @brief Check whether the control structure of a delta is in the code
+     * @param index The index of the delta
+     * @return true if the delta is in the code, false otherwise
+     */
+    bool contains(int index) const;
+
+    /**
+     * @brief Get the number of deltas that have a slot in the offset table
+     * @return The number of deltas
+     */
+    int getDeltaCount() const;
+
+    /**
+     * @brief Get the first instruction of a delta
+     * @param index The index of the delta
+     * @return A pointer to the first instruction
+     */
+    const Instruction *getCode(int index) const;
+
+    /**
+     * @brief Get the number of instructions of a delta
+     * @param index The index of the delta
+     * @return The number of instructions
+     */
+    int getSize(int index) const;
+
+    /**
+     * @brief Get a node referred by an instruction
+     * @param index The constant index
+     * @return The node
+     */
+    const std::shared_ptr<STNode> &getConstant(int index) const;
+
+    /**
+     * @brief Get an instruction as it is shown in the control structures
+     * @param instruction The instruction
+     * @return The instruction as a string
+     */
+    std::string toString(const Instruction &instruction) const;
+
+    /**
+     * @brief Write the code and the constants as an image that can be loaded without generating them again
+     * @param os The output stream to write to
+     * @param flags Flags stored with the image
+     * @param numbers The index each delta is stored under, by its index here; empty to keep the indices
+     * @return false if a constant cannot be stored in an image, true otherwise
+     */
+    bool write(std::ostream &os, uint32_t flags, const std::vector<int> &numbers = {}) const;
+
+    /**
+     * @brief Load the code and the constants from an image written by write; the instructions are used in place
+     * @param file The mapped file containing the image; kept open while the program exists
+     * @param offset The position of the image in the file
+     * @param flags Set to the flags stored with the image
+     * @return true if the image was loaded, false if it is invalid
+     */
+    bool read(std::shared_ptr<SourceFile> file, std::size_t offset, uint32_t &flags);
+
+private:
+    std::vector<Instruction> code;                 // instructions of all the generated deltas, back to back
+    const Instruction *image;                      // instructions inside a loaded image, used instead of code
+    std::shared_ptr<SourceFile> imageFile;         // the mapped file of a loaded image
+    std::vector<int> offsets;                      // position of the first instruction of each delta, -1 if not generated
+    std::vector<int> sizes;                        // number of instructions of each delta
+    std::vector<std::shared_ptr<STNode>> constants; // nodes referred by the instructions
+    std::unordered_map<std::string, int> identifiers;
+
+    /**
+     * @brief Add a node to the constants
+     * @param node The node
+     * @return The constant index of the node
+     */
+    int addConstant(std::shared_ptr<STNode> node);
+
+    /**
+     * @brief Add an identifier to the constants, sharing identifiers with the same name
+     * @param node The identifier
+     * @return The constant index of the identifier
+     */
+    int addIdentifier(std::shared_ptr<STNode> node);
+
+    /**
+     * @brief Append a single node to the code
+     * @param node The node
+     */
+    void emit(std::shared_ptr<STNode> node);
+};
+
+#endif // PROGRAM_H
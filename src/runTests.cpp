@@ -1,3 +1,4 @@
+#include <fstream>
 #include <iostream>
 #include <cppunit/TestRunner.h>
 #include <cppunit/TestResult.h>
@@ -40,6 +41,23 @@ class Test : public CPPUNIT_NS::TestCase
     CPPUNIT_TEST(test_29);
     CPPUNIT_TEST(test_30);
     CPPUNIT_TEST(test_31);
+    CPPUNIT_TEST(test_32);
+    CPPUNIT_TEST(test_33);
+    CPPUNIT_TEST(test_34);
+    CPPUNIT_TEST(test_35);
+    CPPUNIT_TEST(test_36);
+    CPPUNIT_TEST(test_37);
+    CPPUNIT_TEST(test_38);
+    CPPUNIT_TEST(test_39);
+    CPPUNIT_TEST(test_40);
+    CPPUNIT_TEST(test_41);
+    CPPUNIT_TEST(test_42);
+    CPPUNIT_TEST(test_43);
+    CPPUNIT_TEST(test_44);
+    CPPUNIT_TEST(test_45);
+    CPPUNIT_TEST(test_46);
+    CPPUNIT_TEST(test_47);
+    CPPUNIT_TEST(test_48);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -232,6 +250,173 @@ protected:
         system("./myrpal tests/test_31 >output 2>output");
         CPPUNIT_ASSERT(system("diff output tests/out/test_31.out") == 0);
     }
+
+    void test_32(void)
+    {
+        system("./myrpal tests/test_32 >output 2>output");
+        CPPUNIT_ASSERT(system("diff output tests/out/test_32.out") == 0);
+    }
+
+    void test_33(void)
+    {
+        // A function of 10^6 parameters standardizes to lambdas nested 10^6 deep; the input is too large to keep
+        std::ofstream program("deep");
+        program << "let\n.function_form\n..<ID:f>\n";
+        for (int i = 0; i < 1000000; ++i)
+        {
+            program << "..<ID:x" << i << ">\n";
+        }
+        program << "..<INT:0>\n.gamma\n..<ID:Print>\n..gamma\n...<ID:f>\n...<INT:1>\n";
+        program.close();
+
+        system("./myrpal deep >output 2>output");
+        CPPUNIT_ASSERT(system("diff output tests/out/test_33.out") == 0);
+    }
+
+    void test_34(void)
+    {
+        // Convert a program to the binary format and run the converted program
+        system("./myrpal -dump-ast-bin tests/test_18 >ast.bin");
+        system("./myrpal -ast-bin ast.bin >output 2>output");
+        CPPUNIT_ASSERT(system("diff output tests/out/test_18.out") == 0);
+    }
+
+    void test_35(void)
+    {
+        // The first run compiles the program into the cache and the second run executes the cached image
+        system("rm -rf cache");
+        system("./myrpal -cache-dir=cache tests/test_02 >output 2>output");
+        CPPUNIT_ASSERT(system("diff output tests/out/test_02.out") == 0);
+        CPPUNIT_ASSERT(system("test $(ls cache | grep -c '\\.rpalc$') -eq 1") == 0);
+        system("./myrpal -cache-dir=cache -stats=json tests/test_02 >output 2>stats");
+        CPPUNIT_ASSERT(system("diff output tests/out/test_02.out") == 0);
+        CPPUNIT_ASSERT(system("grep -q '\"standardize\": null' stats") == 0);
+    }
+
+    void test_36(void)
+    {
+        // A failing program leaves its last steps in flight.txt, ending with the step that failed
+        system("rm -f flight.txt");
+        system("./myrpal tests/test_36 >output 2>output");
+        CPPUNIT_ASSERT(system("diff output tests/out/test_36.out") == 0);
+        CPPUNIT_ASSERT(system("tail -3 flight.txt | grep -q 'Rule: failed'") == 0);
+    }
+
+    void test_37(void)
+    {
+        // The coverage report of a program
+        system("./myrpal -coverage tests/test_01 >output 2>output");
+        CPPUNIT_ASSERT(system("diff coverage.txt tests/out/test_37.out") == 0);
+    }
+
+    void test_38(void)
+    {
+        // Only the steps passing every filter are printed to exec.txt
+        system("./myrpal -exe-deltas=2,5,8 -exe-rules=1,4,8 -exe-every=3 -exe-steps=100..2000 tests/test_01 "
+               ">output 2>output");
+        CPPUNIT_ASSERT(system("diff exec.txt tests/out/test_38.out") == 0);
+    }
+
+    void test_39(void)
+    {
+        // A compact trace expands back to the full trace
+        system("./myrpal -exe tests/test_01 >output 2>output");
+        system("mv exec.txt exec.expected");
+        system("./myrpal -exe-compact=50 tests/test_01 >output 2>output");
+        system("./rpal-expand exec.compact >output");
+        CPPUNIT_ASSERT(system("diff output exec.expected") == 0);
+    }
+
+    void test_40(void)
+    {
+        // Decode a binary trace, filtered and summarized
+        system("./myrpal -exe-bin tests/test_01 >output 2>output");
+        system("./rpal-trace -rule 4 exec.bin >output");
+        system("./rpal-trace -summary exec.bin >>output");
+        CPPUNIT_ASSERT(system("diff output tests/out/test_40.out") == 0);
+    }
+
+    void test_41(void)
+    {
+        // Sampling every step counts the steps of each call chain exactly
+        system("./myrpal -profile=1 tests/test_01 >output 2>output");
+        CPPUNIT_ASSERT(system("diff profile.folded tests/out/test_41.out") == 0);
+    }
+
+    void test_42(void)
+    {
+        // The counts of the statistics; the phase timings vary between runs
+        system("./myrpal -stats=json tests/test_01 2>&1 >/dev/null | sed 's/, \"phases\".*/}/' >output");
+        CPPUNIT_ASSERT(system("diff output tests/out/test_42.out") == 0);
+    }
+
+    void test_43(void)
+    {
+        // A truncated image and a damaged image are rejected; the program is compiled and cached again
+        system("rm -rf cache");
+        system("./myrpal -cache-dir=cache tests/test_02 >output 2>output");
+        system("for f in cache/*.rpalc; do head -c 100 $f >$f.cut; mv $f.cut $f; done");
+        system("./myrpal -cache-dir=cache -stats=json tests/test_02 >output 2>stats");
+        CPPUNIT_ASSERT(system("diff output tests/out/test_02.out") == 0);
+        CPPUNIT_ASSERT(system("grep -q '\"standardize\": null' stats") != 0);
+
+        // The last byte of the image is changed
+        system("for f in cache/*.rpalc; do head -c -1 $f >$f.cut; tail -c 1 $f | LC_ALL=C tr '\\000-\\377' "
+               "'\\001-\\377\\000' >>$f.cut; mv $f.cut $f; done");
+        system("./myrpal -cache-dir=cache -stats=json tests/test_02 >output 2>stats");
+        CPPUNIT_ASSERT(system("diff output tests/out/test_02.out") == 0);
+        CPPUNIT_ASSERT(system("grep -q '\"standardize\": null' stats") != 0);
+
+        // The image written again is used
+        system("./myrpal -cache-dir=cache -stats=json tests/test_02 >output 2>stats");
+        CPPUNIT_ASSERT(system("diff output tests/out/test_02.out") == 0);
+        CPPUNIT_ASSERT(system("grep -q '\"standardize\": null' stats") == 0);
+    }
+
+    void test_44(void)
+    {
+        // The nodes allocated while running a program, by type and by rule
+        system("./myrpal -alloc tests/test_01 2>output >/dev/null");
+        CPPUNIT_ASSERT(system("diff output tests/out/test_44.out") == 0);
+    }
+
+    void test_45(void)
+    {
+        // The timeline is valid JSON and has a span for each phase of a run
+        system("rm -f timeline.json");
+        system("./myrpal -timeline tests/test_01 >output 2>output");
+        CPPUNIT_ASSERT(system("diff output tests/out/test_01.out") == 0);
+        CPPUNIT_ASSERT(system("python3 -c 'import json; events = json.load(open(\"timeline.json\")); "
+                              "assert {e[\"name\"] for e in events if e[\"cat\"] == \"phase\"} == "
+                              "{\"load\", \"standardize\", \"generate\", \"execute\"}'") == 0);
+    }
+
+    void test_46(void)
+    {
+        // The 3485 steps of the program give 6 samples every 500 steps and a last sample at the end
+        system("rm -f memory.csv");
+        system("./myrpal -memory=500 tests/test_01 >output 2>errors");
+        CPPUNIT_ASSERT(system("diff output tests/out/test_01.out") == 0);
+        CPPUNIT_ASSERT(system("head -1 memory.csv | grep -qx "
+                              "'step,time_ms,control,stack,environments,live_bytes,rss_bytes'") == 0);
+        CPPUNIT_ASSERT(system("test $(wc -l <memory.csv) -eq 8") == 0);
+        CPPUNIT_ASSERT(system("grep -q '^Memory peak at step ' errors") == 0);
+    }
+
+    void test_47(void)
+    {
+        // An = outside of a definition leaves an extra value on the stack; the control structure fails verification, so
+        // the machine keeps the stack checks and reports it
+        system("./myrpal tests/test_47 >output 2>output");
+        CPPUNIT_ASSERT(system("diff output tests/out/test_47.out") == 0);
+    }
+
+    void test_48(void)
+    {
+        // Functions with the same name in different scopes have separate frames, told apart by their lambdas
+        system("./myrpal -profile=1 tests/test_48 >output 2>output");
+        CPPUNIT_ASSERT(system("diff profile.folded tests/out/test_48.out") == 0);
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(Test);
@@ -0,0 +1,111 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include "source.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+SourceFile::SourceFile(string filename)
+{
+    this->data = nullptr;
+    this->size = 0;
+    this->position = 0;
+    this->opened = false;
+    this->mapped = false;
+
+#ifndef _WIN32
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+    {
+        opened = true;
+        size = st.st_size;
+        if (size > 0)
+        {
+            void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED)
+            {
+                madvise(addr, size, MADV_SEQUENTIAL); // the file is read once from the beginning
+                data = static_cast<const char *>(addr);
+                mapped = true;
+            }
+        }
+    }
+    close(fd);
+
+    if (opened && (mapped || size == 0))
+    {
+        return;
+    }
+    opened = false;
+    size = 0;
+#endif
+
+    // Read the whole file into a buffer where it cannot be mapped
+    ifstream _file(filename, ios::binary);
+    if (!_file)
+    {
+        return;
+    }
+
+    string contents((istreambuf_iterator<char>(_file)), istreambuf_iterator<char>());
+    char *buffer = new char[contents.size()];
+    contents.copy(buffer, contents.size());
+    data = buffer;
+    size = contents.size();
+    opened = true;
+}
+
+SourceFile::~SourceFile()
+{
+#ifndef _WIN32
+    if (mapped)
+    {
+        munmap(const_cast<char *>(data), size);
+        return;
+    }
+#endif
+    delete[] data;
+}
+
+bool SourceFile::isOpen() const
+{
+    return opened;
+}
+
+string_view SourceFile::getContent() const
+{
+    return string_view(data, size);
+}
+
+bool SourceFile::nextLine(string_view &line)
+{
+    if (position >= size)
+    {
+        return false;
+    }
+
+    string_view rest(data + position, size - position);
+    size_t end = rest.find('\n');
+    if (end == string_view::npos)
+    {
+        end = rest.length();
+    }
+
+    line = rest.substr(0, end);
+    position += end + 1;
+    return true;
+}
@@ -0,0 +1,49 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+class SourceFile
+{
+public:
+    /**
+     * @brief Map a file into memory
+     * @param filename The name of the file
+     */
+    SourceFile(std::string filename);
+    ~SourceFile();
+
+    SourceFile(const SourceFile &) = delete;
+    SourceFile &operator=(const SourceFile &) = delete;
+
+    /**
+     * @brief Check whether the file was opened
+     * @return true if the file was opened, false otherwise
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Get the contents of the file
+     * @return A view of the whole file
+     */
+    std::string_view getContent() const;
+
+    /**
+     * @brief Get the next line of the file without the line break
+     * @param line Set to a view of the line inside the mapped file
+     * @return true if a line was read, false at the end of the file
+     */
+    bool nextLine(std::string_view &line);
+
+private:
+    const char *data;
+    std::size_t size;
+    std::size_t position;
+    bool opened;
+    bool mapped;
+};
+
+#endif // SOURCE_H
@@ -1,6 +1,9 @@
 #include <iostream>
 #include <iomanip>
 #include <string>
+#include <utility>
+#include <vector>
+#include "allocation.h"
 #include "st.h"
 
 using namespace std;
@@ -8,46 +11,168 @@ using namespace std;
 ST::ST(shared_ptr<STNode> root)
 {
     this->root = root;
+    this->checked = false;
+    this->verified = true;
+    this->compiled = false;
+    this->fusing = true;
+    this->statistics = nullptr;
 }
 
-void ST::execute(bool printCS, bool printExe)
+void ST::execute(const ExecutionOptions &options)
 {
-    vector<vector<shared_ptr<STNode>>> controlStructures; // stores the control structures
-    vector<shared_ptr<Delta>> deltas;                     // stores the deltas
+    // The traces show every step of the CSE rules, as the tools mining them for new superinstructions expect
+    fusing = !options.printExe && options.compactTrace == 0 && !options.binaryTrace;
 
-    shared_ptr<Delta> delta = make_shared<Delta>(0, root); // create the initial delta
-    deltas.push_back(delta);
-
-    int i = 0;
-    while (i < (int)deltas.size())
+    if (options.printCS || options.printExe || options.compactTrace > 0 || options.binaryTrace || options.profileInterval > 0 ||
+        options.memoryInterval > 0 || options.coverage)
     {
-        // iterate through the deltas
-        vector<shared_ptr<STNode>> controlStructure;
-
-        // go in preorder through the subtree referenced by the delta and generate the control structures
-        preOrder(deltas[i]->getChildren()[0], controlStructure, deltas);
-        controlStructures.push_back(controlStructure);
-        ++i;
+        compile();
+    }
+    else if (!compiled)
+    {
+        // Deltas are numbered as they are identified; closures are printed with the numbers of a full traversal
+        deltas.push_back(makeNode<Delta>(0, root)); // create the initial delta
     }
 
-    if (printCS)
+    this->checked = options.checked || !verified;
+
+    if (options.printCS)
     {
-        int width = 6 + to_string(controlStructures.size()).length();
-        for (int i = 0; i < (int)controlStructures.size(); ++i)
+        int deltaCount = program.getDeltaCount();
+        int width = 6 + to_string(deltaCount).length();
+        for (int i = 0; i < deltaCount; ++i)
         {
             cout << right << setw(width) << ("delta_" + to_string(i)) << left << ": ";
-            int ith_size = controlStructures[i].size();
-            for (int j = 0; j < (int)controlStructures[i].size(); ++j)
+            const Instruction *code = program.getCode(i);
+            int ith_size = program.getSize(i);
+            for (int j = 0; j < ith_size; ++j)
             {
-                shared_ptr<STNode> node = controlStructures[i][j];
-                cout << (node->getType() == "String" ? "'" + node->toString() + "'" : node->toString())
-                     << (j == ith_size - 1 ? "\n" : " ");
+                cout << program.toString(code[j]) << (j == ith_size - 1 ? "\n" : " ");
             }
         }
         cout << "\n";
     }
 
-    runCSEMachine(controlStructures, printExe); // run the CSE machine with the control structures
+    // Control structures generated during the execution are counted as generation
+    double generation = statistics != nullptr ? statistics->times[Statistics::GENERATE] : 0;
+    PhaseTimer timer(statistics, Statistics::EXECUTE);
+    runCSEMachine(options); // run the CSE machine with the control structures
+    timer.stop();
+    if (statistics != nullptr)
+        statistics->times[Statistics::EXECUTE] -= statistics->times[Statistics::GENERATE] - generation;
+}
+
+void ST::compile()
+{
+    if (compiled)
+    {
+        return;
+    }
+
+    // Generate all the control structures in order so that the deltas are numbered as in a full traversal
+    deltas.push_back(makeNode<Delta>(0, root)); // create the initial delta
+    for (int i = 0; i < (int)deltas.size(); ++i)
+    {
+        generate(i);
+    }
+    compiled = true;
+}
+
+void ST::setStatistics(Statistics *statistics)
+{
+    this->statistics = statistics;
+}
+
+bool ST::writeProgram(ostream &os)
+{
+    if (compiled || deltas.empty())
+    {
+        compile();
+        return program.write(os, verified);
+    }
+
+    // Generating a delta identifies the deltas in it, so this reaches all of them
+    for (int i = 0; i < (int)deltas.size(); ++i)
+    {
+        if (!program.contains(i))
+        {
+            generate(i);
+        }
+    }
+
+    vector<int> numbers;
+    for (int i = 0; i < (int)deltas.size(); ++i)
+    {
+        numbers.push_back(getNumber(i));
+    }
+    return program.write(os, verified, numbers);
+}
+
+bool ST::readProgram(shared_ptr<SourceFile> file, size_t offset)
+{
+    uint32_t flags;
+    if (!program.read(file, offset, flags))
+    {
+        return false;
+    }
+
+    // The stored flag only says whether the deltas were verified when they were generated; the code itself is
+    // verified again, so that a damaged image is run with the runtime stack checks
+    verified = flags != 0;
+    for (int i = 0; i < program.getDeltaCount() && verified; ++i)
+    {
+        if (program.contains(i) && !verify(i))
+            verified = false;
+    }
+    compiled = true;
+    return true;
+}
+
+void ST::generate(int index)
+{
+    PhaseTimer timer(statistics, Statistics::GENERATE);
+    vector<shared_ptr<STNode>> controlStructure;
+
+    // go in preorder through the subtree referenced by the delta and generate the control structures
+    preOrder(deltas[index]->getChildren()[0], controlStructure, deltas);
+    if (fusing)
+        fuse(controlStructure);
+
+    // Skip the runtime stack checks only while every entered control structure is proven to keep the stack discipline
+    if (!verify(controlStructure, deltas.size()))
+    {
+        verified = false;
+        checked = true;
+    }
+
+    program.add(index, controlStructure);
+}
+
+const Instruction *ST::getCode(int index)
+{
+    if (!program.contains(index))
+    {
+        generate(index);
+    }
+
+    return program.getCode(index);
+}
+
+int ST::getNumber(int index)
+{
+    if (numbers.empty())
+    {
+        // The bodies are collected in the order in which a full generation identifies the deltas
+        vector<shared_ptr<STNode>> bodies;
+        bodies.push_back(root);
+        for (int i = 0; i < (int)bodies.size(); ++i)
+        {
+            numbers[bodies[i].get()] = i;
+            collectDeltas(bodies[i], bodies);
+        }
+    }
+
+    return numbers[deltas[index]->getChildren()[0].get()];
 }
 
 ostream &operator<<(ostream &os, const ST &st)
@@ -63,95 +188,173 @@ void ST::printST()
 
 void ST::preOrder(shared_ptr<STNode> node, int level, ostream &os) const
 {
-    if (node == nullptr)
+    // An explicit stack of nodes and their depths, so the depth of the tree is not limited by the call stack
+    vector<pair<shared_ptr<STNode>, int>> nodes;
+    if (node != nullptr)
     {
-        return;
+        nodes.push_back({node, level});
     }
 
-    for (int i = 0; i < level; ++i)
+    while (!nodes.empty())
     {
-        os << ".";
-    }
+        auto [current, depth] = nodes.back();
+        nodes.pop_back();
 
-    os << node->toCompleteString() << "\n";
+        for (int i = 0; i < depth; ++i)
+        {
+            os << ".";
+        }
 
-    if (node->getType() == "Arrow")
-    {
-        auto children = node->getChildren();
-        preOrder(children[3], level + 1, os);
-        preOrder(children[0]->getChildren()[0], level + 1, os);
-        preOrder(children[1]->getChildren()[0], level + 1, os);
-    }
-    else if (node->getType() == "Lambda")
-    {
-        shared_ptr<Lambda> l = dynamic_pointer_cast<Lambda>(node);
-        auto children = l->getChildren();
-        auto bindings = l->getBindings();
-        int bindingCount = l->getBindingCount();
+        os << current->toCompleteString() << "\n";
 
-        if (bindingCount == 1)
+        // The children are pushed in reverse so that they come out in order
+        vector<shared_ptr<STNode>> children;
+        if (current->getType() == "Arrow")
         {
-            preOrder(bindings[0], level + 1, os);
+            auto arrowChildren = current->getChildren();
+            children = {arrowChildren[3], arrowChildren[0]->getChildren()[0], arrowChildren[1]->getChildren()[0]};
         }
-        else if (bindingCount > 1)
+        else if (current->getType() == "Lambda")
         {
-            shared_ptr<STNode> c = make_shared<Comma>();
-            for (int i = 0; i < bindingCount; ++i)
+            shared_ptr<Lambda> l = dynamic_pointer_cast<Lambda>(current);
+            auto bindings = l->getBindings();
+            int bindingCount = l->getBindingCount();
+
+            if (bindingCount == 1)
             {
-                c->addChild(bindings[i]);
+                children.push_back(bindings[0]);
+            }
+            else if (bindingCount > 1)
+            {
+                shared_ptr<STNode> c = makeNode<Comma>();
+                for (int i = 0; i < bindingCount; ++i)
+                {
+                    c->addChild(bindings[i]);
+                }
+                children.push_back(c);
             }
-            preOrder(c, level + 1, os);
-        }
 
-        for (auto child : children)
+            for (auto child : l->getChildren())
+            {
+                children.push_back(child);
+            }
+        }
+        else
         {
-            preOrder(child, level + 1, os);
+            children = current->getChildren();
         }
-    }
-    else
-    {
-        for (auto child : node->getChildren())
+
+        for (int i = (int)children.size() - 1; i >= 0; --i)
         {
-            preOrder(child, level + 1, os);
+            if (children[i] != nullptr)
+            {
+                nodes.push_back({children[i], depth + 1});
+            }
         }
     }
 }
 
-void ST::preOrder(shared_ptr<STNode> node, vector<shared_ptr<STNode>> &controlStructure, vector<shared_ptr<Delta>> &deltas) const
+void ST::preOrder(shared_ptr<STNode> node, vector<shared_ptr<STNode>> &controlStructure, vector<shared_ptr<Delta>> &deltas)
 {
-    if (node == nullptr)
+    pending.clear();
+    if (node != nullptr)
     {
-        return;
+        pending.push_back(node);
     }
 
-    bool expandChildren = true;
-    string nodeType = node->getType();
-    if (nodeType != "Arrow") // skip the arrow node
+    while (!pending.empty())
     {
+        shared_ptr<STNode> current = move(pending.back());
+        pending.pop_back();
+
+        string nodeType = current->getType();
+        if (nodeType == "Arrow")
+        {
+            // Children of the arrow node are delta_then, delta_else, beta and the condition
+            auto children = current->getChildren();
+            shared_ptr<Delta> deltaThen = dynamic_pointer_cast<Delta>(children[0]);
+            shared_ptr<Delta> deltaElse = dynamic_pointer_cast<Delta>(children[1]);
+            shared_ptr<Beta> beta = dynamic_pointer_cast<Beta>(children[2]);
+
+            // Register the deltas; their children will be traversed later
+            deltaThen->setIndex(deltas.size());
+            deltas.push_back(deltaThen);
+            deltaElse->setIndex(deltas.size());
+            deltas.push_back(deltaElse);
+
+            // Compile the conditional into a single branch carrying both targets
+            beta->setTargets(deltaThen->getIndex(), deltaElse->getIndex());
+            controlStructure.push_back(beta);
+
+            if (children[3] != nullptr)
+            {
+                pending.push_back(children[3]); // the condition
+            }
+            continue;
+        }
+
+        controlStructure.push_back(current); // add the node to the control structure
+
         if (nodeType == "Lambda")
         {
-            dynamic_pointer_cast<Lambda>(node)->setIndex(deltas.size());
-            shared_ptr<Delta> delta = make_shared<Delta>((int)deltas.size(), node->getChildren()[0]); // create a new delta for the right child of lambda
+            dynamic_pointer_cast<Lambda>(current)->setIndex(deltas.size());
+            shared_ptr<Delta> delta = makeNode<Delta>((int)deltas.size(), current->getChildren()[0]); // create a new delta for the right child of lambda
             deltas.push_back(delta);
-            expandChildren = false; // skip traversing through the children of lambda; they will be traversed through the new delta
+            continue; // skip traversing through the children of lambda; they will be traversed through the new delta
         }
 
-        else if (nodeType == "Delta")
+        // Push the children in reverse so that they are visited in order
+        auto children = current->getChildren();
+        for (int i = (int)children.size() - 1; i >= 0; --i)
         {
-            // delta_then or delta_else of arrow node
-            dynamic_pointer_cast<Delta>(node)->setIndex(deltas.size());
-            deltas.push_back(dynamic_pointer_cast<Delta>(node));
-            expandChildren = false; // skip traversing through the children of delta; they will be traversed later
+            if (children[i] != nullptr)
+            {
+                pending.push_back(children[i]);
+            }
         }
+    }
+}
 
-        controlStructure.push_back(node); // add the node to the control structure
+void ST::collectDeltas(shared_ptr<STNode> node, vector<shared_ptr<STNode>> &bodies)
+{
+    // Same order of visits as the generation of control structures
+    pending.clear();
+    if (node != nullptr)
+    {
+        pending.push_back(node);
     }
 
-    if (expandChildren)
+    while (!pending.empty())
     {
-        for (auto child : node->getChildren())
+        shared_ptr<STNode> current = move(pending.back());
+        pending.pop_back();
+
+        string nodeType = current->getType();
+        if (nodeType == "Arrow")
         {
-            preOrder(child, controlStructure, deltas);
+            auto children = current->getChildren();
+            bodies.push_back(children[0]->getChildren()[0]); // body of delta_then
+            bodies.push_back(children[1]->getChildren()[0]); // body of delta_else
+            if (children[3] != nullptr)
+            {
+                pending.push_back(children[3]); // the condition
+            }
+            continue;
+        }
+
+        if (nodeType == "Lambda")
+        {
+            bodies.push_back(current->getChildren()[0]); // the body of the lambda is traversed as a separate delta
+            continue;
+        }
+
+        auto children = current->getChildren();
+        for (int i = (int)children.size() - 1; i >= 0; --i)
+        {
+            if (children[i] != nullptr)
+            {
+                pending.push_back(children[i]);
+            }
         }
     }
 }
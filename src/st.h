@@ -1,10 +1,36 @@
 #ifndef ST_H
 #define ST_H
 
+#include <cstddef>
 #include <iostream>
 #include <memory>
+#include <set>
+#include <unordered_map>
 #include <vector>
+#include "program.h"
+#include "source.h"
 #include "st_types.h"
+#include "stats.h"
+
+// Options for the execution of an ST
+struct ExecutionOptions
+{
+    bool printCS = false;     // print the control structures
+    bool printExe = false;    // write the execution of the CSE Machine to exec.txt
+    bool checked = false;     // keep the runtime stack checks even if the control structures are verified
+    long compactTrace = 0;    // steps between snapshots in exec.compact, 0 to not write it
+    bool binaryTrace = false; // write a record of each step to exec.bin
+    long profileInterval = 0; // steps between the samples written to profile.folded, 0 to not profile
+    long memoryInterval = 0;  // steps between the samples written to memory.csv, 0 to not sample
+    bool coverage = false;    // write the execution counts of the control structures to coverage.txt
+
+    // Steps written to exec.txt; a step is written if it passes all of them
+    std::set<int> traceDeltas; // deltas whose instructions are traced, all if empty
+    std::set<int> traceRules;  // CSE rules that are traced, all if empty
+    long traceEvery = 1;       // trace every Nth step
+    long traceFrom = 1;        // first traced step
+    long traceTo = -1;         // last traced step, -1 for no limit
+};
 
 class ST
 {
@@ -12,11 +38,37 @@ public:
     ST(std::shared_ptr<STNode> root);
 
     /**
-     * @brief Generate the control structures and start the execution of the CSE Machine
-     * @param printCS Whether to print the control structures
-     * @param printExe Whether to print the execution of the CSE Machine
+     * @brief Start the execution of the CSE Machine, generating the control structures as they are entered
+     * @param options The execution options; all control structures are generated before execution if anything is printed
+     */
+    void execute(const ExecutionOptions &options);
+
+    /**
+     * @brief Generate the control structures of all the deltas in order
+     */
+    void compile();
+
+    /**
+     * @brief Generate the control structures of all the deltas and write them as an image. After a lazy execution only the
+     *        deltas never entered are generated, and the deltas are stored under the indices of a full generation
+     * @param os The output stream to write to
+     * @return false if the program cannot be stored in an image, true otherwise
      */
-    void execute(bool printCS, bool printExe);
+    bool writeProgram(std::ostream &os);
+
+    /**
+     * @brief Use the control structures of an image instead of generating them
+     * @param file The mapped file containing the image
+     * @param offset The position of the image in the file
+     * @return true if the image was loaded, false if it is invalid
+     */
+    bool readProgram(std::shared_ptr<SourceFile> file, std::size_t offset);
+
+    /**
+     * @brief Count the work of the generation and the execution
+     * @param statistics The statistics to add to, or nullptr to not count
+     */
+    void setStatistics(Statistics *statistics);
 
     /**
      * @brief Print the ST to stdout
@@ -27,13 +79,72 @@ public:
 
 private:
     std::shared_ptr<STNode> root;
+    std::vector<std::shared_ptr<Delta>> deltas; // identified deltas; the index of a delta is its position
+    Program program;                            // instructions of the generated deltas
+    std::unordered_map<STNode *, int> numbers;  // delta numbers in a full generation, keyed by delta body
+    bool checked;                               // whether the machine checks the stack on each step
+    bool verified;                              // whether all the generated control structures were verified
+    bool compiled;                              // whether all the control structures were generated in order
+    bool fusing;                                // whether generated control structures use superinstructions
+    Statistics *statistics;                     // counters of -stats, nullptr if not counted
+    std::vector<std::shared_ptr<STNode>> pending; // work stack of the traversals, reused across deltas
 
     /**
      * @brief Run the CSE machine according to the CSE Rules
-     * @param controlStructures A 2D vector containing the control structures
-     * @param printExe Whether to print the execution of the CSE Machine
+     * @param options The execution options
+     */
+    void runCSEMachine(const ExecutionOptions &options);
+
+    /**
+     * @brief Generate the control structure of a delta and register the deltas found in it
+     * @param index The index of the delta
+     */
+    void generate(int index);
+
+    /**
+     * @brief Get the instructions of a delta, generating them on first use
+     * @param index The index of the delta
+     * @return A pointer to the first instruction
+     */
+    const Instruction *getCode(int index);
+
+    /**
+     * @brief Get the index a delta would have if all control structures were generated before execution
+     * @param index The index of the delta
+     * @return The index in a full generation
+     */
+    int getNumber(int index);
+
+    /**
+     * @brief Traverse the ST in preorder and collect the bodies of the deltas in the same order as they are identified while
+     *        generating control structures
+     * @param node The node to process
+     * @param bodies A reference to a vector containing the collected bodies
+     */
+    void collectDeltas(std::shared_ptr<STNode> node, std::vector<std::shared_ptr<STNode>> &bodies);
+
+    /**
+     * @brief Replace frequent sequences of nodes in a control structure by superinstructions
+     * @param controlStructure The control structure to rewrite
+     */
+    void fuse(std::vector<std::shared_ptr<STNode>> &controlStructure) const;
+
+    /**
+     * @brief Statically verify the stack effect of a control structure
+     * @param controlStructure The control structure to verify
+     * @param deltaCount The number of control structures a lambda or beta may refer to
+     * @return true if executing the control structure leaves exactly one value above the stack contents it started with and never
+     *         reads below them, false otherwise
+     */
+    bool verify(const std::vector<std::shared_ptr<STNode>> &controlStructure, int deltaCount) const;
+
+    /**
+     * @brief Statically verify the stack effect of the loaded code of a delta, as the control structure it was generated from
+     * @param index The index of the delta
+     * @return true if executing the code leaves exactly one value above the stack contents it started with and never reads
+     *         below them, false otherwise
      */
-    void runCSEMachine(std::vector<std::vector<std::shared_ptr<STNode>>> &controlStructures, bool printExe);
+    bool verify(int index) const;
 
     /**
      * @brief Traverse the ST in preorder and print the tree
@@ -49,7 +160,7 @@ private:
      * @param controlStructure A reference to a vector containing the control structures of current subtree
      * @param deltas A reference to a vector containing the identified delta nodes
      */
-    void preOrder(std::shared_ptr<STNode> node, std::vector<std::shared_ptr<STNode>> &controlStructure, std::vector<std::shared_ptr<Delta>> &deltas) const;
+    void preOrder(std::shared_ptr<STNode> node, std::vector<std::shared_ptr<STNode>> &controlStructure, std::vector<std::shared_ptr<Delta>> &deltas);
 };
 
 #endif // ST_H
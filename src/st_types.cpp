@@ -1,12 +1,43 @@
 #include <iostream>
 #include <cmath>
+#include <cstring>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
+#include "allocation.h"
 #include "st_types.h"
 
 using namespace std;
 
+STNode::~STNode()
+{
+    release(children);
+}
+
+void STNode::detach(vector<shared_ptr<STNode>> &nodes)
+{
+    for (auto &child : children)
+    {
+        nodes.push_back(move(child));
+    }
+    children.clear();
+}
+
+void STNode::release(vector<shared_ptr<STNode>> &nodes)
+{
+    // A node is destroyed only after its own nodes are taken out, so deep trees do not recurse through the destructors
+    while (!nodes.empty())
+    {
+        shared_ptr<STNode> node = move(nodes.back());
+        nodes.pop_back();
+        if (node != nullptr && node.use_count() == 1)
+        {
+            node->detach(nodes);
+        }
+    }
+}
+
 void STNode::addChild(shared_ptr<STNode> child)
 {
     children.push_back(child);
@@ -22,7 +53,7 @@ string STNode::toCompleteString() const
     return toString();
 }
 
-void STNode::print() const
+void STNode::print(const function<int(int)> &) const
 {
     cout << *this;
 }
@@ -65,27 +96,27 @@ string TruthValue::getType() const
 
 shared_ptr<TruthValue> TruthValue::operator&&(shared_ptr<TruthValue> other) const
 {
-    return make_shared<TruthValue>(value && other->getValue());
+    return makeNode<TruthValue>(value && other->getValue());
 }
 
 shared_ptr<TruthValue> TruthValue::operator||(shared_ptr<TruthValue> other) const
 {
-    return make_shared<TruthValue>(value || other->getValue());
+    return makeNode<TruthValue>(value || other->getValue());
 }
 
 shared_ptr<TruthValue> TruthValue::operator!() const
 {
-    return make_shared<TruthValue>(!value);
+    return makeNode<TruthValue>(!value);
 }
 
 shared_ptr<TruthValue> TruthValue::operator==(shared_ptr<TruthValue> other) const
 {
-    return make_shared<TruthValue>(value == other->getValue());
+    return makeNode<TruthValue>(value == other->getValue());
 }
 
 shared_ptr<TruthValue> TruthValue::operator!=(shared_ptr<TruthValue> other) const
 {
-    return make_shared<TruthValue>(value != other->getValue());
+    return makeNode<TruthValue>(value != other->getValue());
 }
 
 Integer::Integer(string value)
@@ -120,62 +151,62 @@ string Integer::getType() const
 
 shared_ptr<Integer> Integer::negate() const
 {
-    return make_shared<Integer>(-value);
+    return makeNode<Integer>(-value);
 }
 
 shared_ptr<Integer> Integer::operator+(shared_ptr<Integer> other) const
 {
-    return make_shared<Integer>(value + other->getValue());
+    return makeNode<Integer>(value + other->getValue());
 }
 
 shared_ptr<Integer> Integer::operator-(shared_ptr<Integer> other) const
 {
-    return make_shared<Integer>(value - other->getValue());
+    return makeNode<Integer>(value - other->getValue());
 }
 
 shared_ptr<Integer> Integer::operator*(shared_ptr<Integer> other) const
 {
-    return make_shared<Integer>(value * other->getValue());
+    return makeNode<Integer>(value * other->getValue());
 }
 
 shared_ptr<Integer> Integer::operator/(shared_ptr<Integer> other) const
 {
-    return make_shared<Integer>(value / other->getValue());
+    return makeNode<Integer>(value / other->getValue());
 }
 
 shared_ptr<Integer> Integer::operator^(shared_ptr<Integer> other) const
 {
-    return make_shared<Integer>((int)pow(value, other->getValue()));
+    return makeNode<Integer>((int)pow(value, other->getValue()));
 }
 
 shared_ptr<TruthValue> Integer::operator==(shared_ptr<Integer> other) const
 {
-    return make_shared<TruthValue>(value == other->getValue());
+    return makeNode<TruthValue>(value == other->getValue());
 }
 
 shared_ptr<TruthValue> Integer::operator!=(shared_ptr<Integer> other) const
 {
-    return make_shared<TruthValue>(value != other->getValue());
+    return makeNode<TruthValue>(value != other->getValue());
 }
 
 shared_ptr<TruthValue> Integer::operator<(shared_ptr<Integer> other) const
 {
-    return make_shared<TruthValue>(value < other->getValue());
+    return makeNode<TruthValue>(value < other->getValue());
 }
 
 shared_ptr<TruthValue> Integer::operator<=(shared_ptr<Integer> other) const
 {
-    return make_shared<TruthValue>(value <= other->getValue());
+    return makeNode<TruthValue>(value <= other->getValue());
 }
 
 shared_ptr<TruthValue> Integer::operator>(shared_ptr<Integer> other) const
 {
-    return make_shared<TruthValue>(value > other->getValue());
+    return makeNode<TruthValue>(value > other->getValue());
 }
 
 shared_ptr<TruthValue> Integer::operator>=(shared_ptr<Integer> other) const
 {
-    return make_shared<TruthValue>(value >= other->getValue());
+    return makeNode<TruthValue>(value >= other->getValue());
 }
 
 String::String(string value)
@@ -208,89 +239,86 @@ string String::getType() const
     return "String";
 }
 
-void String::print() const
+void String::print(const function<int(int)> &) const
 {
-    bool backslash = false;
-    for (char c : value)
+    // Write the runs between escape characters at once
+    const char *begin = value.data();
+    const char *end = begin + value.length();
+    while (begin < end)
     {
-        if (backslash)
+        const char *backslash = static_cast<const char *>(memchr(begin, '\\', end - begin));
+        if (backslash == nullptr)
         {
-            // Correctly print escaped characters
-            switch (c)
-            {
-            case 'n':
-                cout << endl;
-                break;
-            case 't':
-                cout << '\t';
-                break;
-            case '\\':
-                cout << '\\';
-                break;
-            default:
-                cout << c;
-                break;
-            }
-            backslash = false;
+            cout.write(begin, end - begin);
+            break;
         }
-        else
+
+        cout.write(begin, backslash - begin);
+        if (backslash + 1 == end)
         {
-            if (c == '\\')
-            {
-                // Escape character
-                backslash = true;
-            }
-            else
-            {
-                cout << c;
-            }
+            break; // a trailing escape character prints nothing
+        }
+
+        // Correctly print escaped characters
+        switch (backslash[1])
+        {
+        case 'n':
+            cout.put('\n');
+            break;
+        case 't':
+            cout.put('\t');
+            break;
+        default:
+            cout.put(backslash[1]);
+            break;
         }
+        begin = backslash + 2;
     }
 }
 
 shared_ptr<TruthValue> String::operator==(shared_ptr<String> other) const
 {
-    return make_shared<TruthValue>(value == other->getValue());
+    return makeNode<TruthValue>(value == other->getValue());
 }
 
 shared_ptr<TruthValue> String::operator!=(shared_ptr<String> other) const
 {
-    return make_shared<TruthValue>(value != other->getValue());
+    return makeNode<TruthValue>(value != other->getValue());
 }
 
 shared_ptr<TruthValue> String::operator<(shared_ptr<String> other) const
 {
-    return make_shared<TruthValue>(value.compare(other->getValue()) < 0);
+    return makeNode<TruthValue>(value.compare(other->getValue()) < 0);
 }
 
 shared_ptr<TruthValue> String::operator<=(shared_ptr<String> other) const
 {
-    return make_shared<TruthValue>(value.compare(other->getValue()) <= 0);
+    return makeNode<TruthValue>(value.compare(other->getValue()) <= 0);
 }
 
 shared_ptr<TruthValue> String::operator>(shared_ptr<String> other) const
 {
-    return make_shared<TruthValue>(value.compare(other->getValue()) > 0);
+    return makeNode<TruthValue>(value.compare(other->getValue()) > 0);
 }
 
 shared_ptr<TruthValue> String::operator>=(shared_ptr<String> other) const
 {
-    return make_shared<TruthValue>(value.compare(other->getValue()) >= 0);
+    return makeNode<TruthValue>(value.compare(other->getValue()) >= 0);
 }
 
 shared_ptr<String> String::operator+(shared_ptr<String> other) const
 {
-    return make_shared<String>(value + other->getValue());
+    return makeNode<String>(value + other->getValue());
 }
 
 shared_ptr<String> String::stem() const
 {
-    return make_shared<String>(value[0]);
+    return makeNode<String>(value[0]);
 }
 
 shared_ptr<String> String::stern() const
 {
-    return make_shared<String>(value.substr(1, value.length() - 1));
+    return makeNode<String>(value.substr(1, value.length() - 1));
 }
 
 Tuple::Tuple()
@@ -304,6 +332,22 @@ Tuple::Tuple(vector<shared_ptr<STNode>> values)
     this->size = values.size();
 }
 
+Tuple::~Tuple()
+{
+    release(values);
+}
+
+void Tuple::detach(vector<shared_ptr<STNode>> &nodes)
+{
+    STNode::detach(nodes);
+    for (auto &value : values)
+    {
+        nodes.push_back(move(value));
+    }
+    values.clear();
+    size = 0;
+}
+
 vector<shared_ptr<STNode>> Tuple::getValues() const
 {
     return values;
@@ -316,7 +360,7 @@ int Tuple::getOrder() const
 
 shared_ptr<Tuple> Tuple::getCopy() const
 {
-    shared_ptr<Tuple> t = make_shared<Tuple>();
+    shared_ptr<Tuple> t = makeNode<Tuple>();
     for (auto value : values)
     {
         string valueStr = value->getType();
@@ -342,37 +386,21 @@ shared_ptr<Tuple> Tuple::getCopy() const
 
 string Tuple::toString() const
 {
-    if (size == 0)
-        return "nil";
-
-    string str = "(";
-    for (int i = 0; i < size; ++i)
-    {
-        str += values[i]->toString();
-        if (i != size - 1)
-        {
-            str += ", ";
-        }
-    }
-    str += ")";
+    string str;
+    traverse("nil", [&str](const char *text)
+             { str += text; },
+             [&str](const STNode &element)
+             { str += element.toString(); });
     return str;
 }
 
 string Tuple::toCompleteString() const
 {
-    if (size == 0)
-        return "<nil>";
-
-    string str = "(";
-    for (int i = 0; i < size; ++i)
-    {
-        str += values[i]->toCompleteString();
-        if (i != size - 1)
-        {
-            str += ", ";
-        }
-    }
-    str += ")";
+    string str;
+    traverse("<nil>", [&str](const char *text)
+             { str += text; },
+             [&str](const STNode &element)
+             { str += element.toCompleteString(); });
     return str;
 }
 
@@ -381,24 +409,54 @@ string Tuple::getType() const
     return "Tuple";
 }
 
-void Tuple::print() const
+void Tuple::print(const function<int(int)> &numbering) const
 {
-    if (size == 0)
-    {
-        cout << "nil";
-        return;
-    }
+    traverse("nil", [](const char *text)
+             { cout << text; },
+             [&](const STNode &element)
+             { element.print(numbering); });
+}
 
-    cout << "(";
-    for (int i = 0; i < size; ++i)
+void Tuple::traverse(const char *nil, const function<void(const char *)> &text,
+                     const function<void(const STNode &)> &element) const
+{
+    // Each entry is either a node to visit or, when the node is null, text to emit
+    vector<pair<const STNode *, const char *>> pending = {{this, nullptr}};
+    while (!pending.empty())
     {
-        values[i]->print();
-        if (i != size - 1)
+        auto [node, str] = pending.back();
+        pending.pop_back();
+
+        if (node == nullptr)
+        {
+            text(str);
+        }
+        else if (node->getType() != "Tuple")
+        {
+            element(*node);
+        }
+        else
         {
-            cout << ", ";
+            const Tuple *tuple = static_cast<const Tuple *>(node);
+            if (tuple->size == 0)
+            {
+                text(nil);
+                continue;
+            }
+
+            // Push in reverse so that the elements come out in order
+            text("(");
+            pending.push_back({nullptr, ")"});
+            for (int i = tuple->size - 1; i >= 0; --i)
+            {
+                pending.push_back({tuple->values[i].get(), nullptr});
+                if (i != 0)
+                {
+                    pending.push_back({nullptr, ", "});
+                }
+            }
         }
     }
-    cout << ")";
 }
 
 void Tuple::push_back(shared_ptr<STNode> value)
@@ -418,22 +476,27 @@ shared_ptr<STNode> Tuple::operator[](int index) const
 
 Identifier::Identifier(string name)
 {
-    this->name = name;
+    this->name = make_shared<const string>(move(name));
 }
 
-string Identifier::getName() const
+Identifier::Identifier(shared_ptr<const string> name)
 {
-    return name;
+    this->name = move(name);
+}
+
+const string &Identifier::getName() const
+{
+    return *name;
 }
 
 string Identifier::toString() const
 {
-    return name;
+    return *name;
 }
 
 string Identifier::toCompleteString() const
 {
-    return "<ID:" + name + ">";
+    return "<ID:" + *name + ">";
 }
 
 string Identifier::getType() const
@@ -519,7 +582,7 @@ bool Function::isFull() const
 
 shared_ptr<Function> Function::getCopy() const
 {
-    return make_shared<Function>(name, arity);
+    return makeNode<Function>(name, arity);
 }
 
 string Function::toString() const
@@ -555,10 +618,11 @@ Lambda::Lambda()
 
 shared_ptr<Lambda> Lambda::getCopy() const
 {
-    shared_ptr<Lambda> copy = make_shared<Lambda>();
+    shared_ptr<Lambda> copy = makeNode<Lambda>();
     copy->index = index;
     copy->env = env;
     copy->bindingCount = bindingCount;
+    copy->name = name;
     copy->bindings = bindings;
     return copy;
 }
@@ -609,7 +673,7 @@ string Lambda::getType() const
     return "Lambda";
 }
 
-void Lambda::print() const
+void Lambda::print(const function<int(int)> &numbering) const
 {
     cout << "[lambda closure: ";
     if (bindingCount > 1)
@@ -617,7 +681,7 @@ void Lambda::print() const
         cout << "(";
         for (int i = 0; i < bindingCount; ++i)
         {
-            bindings[i]->print();
+            bindings[i]->print(numbering);
             if (i != bindingCount - 1)
             {
                 cout << ", ";
@@ -627,9 +691,9 @@ void Lambda::print() const
     }
     else
     {
-        bindings[0]->print();
+        bindings[0]->print(numbering);
     }
-    cout << ": " << index << "]";
+    cout << ": " << (numbering ? numbering(index) : index) << "]";
 }
 
 int Lambda::getBindingCount() const
@@ -658,6 +722,16 @@ void Lambda::setIndex(int index)
     this->index = index;
 }
 
+string Lambda::getName() const
+{
+    return name;
+}
+
+void Lambda::setName(string name)
+{
+    this->name = name;
+}
+
 int Lambda::getEnv() const
 {
     return env;
@@ -755,11 +829,17 @@ int Delta::getIndex() const
 
 Beta::Beta()
 {
+    this->thenIndex = -1;
+    this->elseIndex = -1;
 }
 
 string Beta::toString() const
 {
-    return "beta";
+    if (thenIndex < 0)
+        return "beta";
+
+    // Show the branch targets the same way as the deltas preceding beta in the control structures
+    return "delta_" + to_string(thenIndex) + " delta_" + to_string(elseIndex) + " beta";
 }
 
 string Beta::getType() const
@@ -767,6 +847,22 @@ string Beta::getType() const
     return "Beta";
 }
 
+void Beta::setTargets(int thenIndex, int elseIndex)
+{
+    this->thenIndex = thenIndex;
+    this->elseIndex = elseIndex;
+}
+
+int Beta::getThenIndex() const
+{
+    return thenIndex;
+}
+
+int Beta::getElseIndex() const
+{
+    return elseIndex;
+}
+
 Equal::Equal()
 {
 }
@@ -888,6 +984,42 @@ int Eta::getIndex() const
     return l->getIndex();
 }
 
+Superinstruction::Superinstruction(SuperinstructionKind kind, vector<shared_ptr<STNode>> nodes)
+{
+    this->kind = kind;
+    this->nodes = nodes;
+}
+
+SuperinstructionKind Superinstruction::getKind() const
+{
+    return kind;
+}
+
+const shared_ptr<STNode> &Superinstruction::getNode(int index) const
+{
+    return nodes[index];
+}
+
+string Superinstruction::toString() const
+{
+    // Print the fused nodes as they would appear in the control structure
+    string s = "";
+    for (int i = 0; i < (int)nodes.size(); ++i)
+    {
+        s += nodes[i]->toString();
+        if (i != (int)nodes.size() - 1)
+        {
+            s += " ";
+        }
+    }
+    return s;
+}
+
+string Superinstruction::getType() const
+{
+    return "Superinstruction";
+}
+
 Dummy::Dummy()
 {
 }
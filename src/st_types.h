@@ -1,6 +1,7 @@
 #ifndef ST_TYPES_H
 #define ST_TYPES_H
 
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <vector>
@@ -8,6 +9,8 @@
 class STNode
 {
 public:
+    virtual ~STNode();
+
     /**
      * @brief Add a children to the node
      * @param child The child to add
@@ -40,13 +43,26 @@ public:
 
     /**
      * @brief Prints the node for the 'Print' function
+     * @param numbering A function mapping the index of a lambda to the index shown, or nullptr to show the index itself
      */
-    virtual void print() const;
+    virtual void print(const std::function<int(int)> &numbering) const;
 
     friend std::ostream &operator<<(std::ostream &os, const STNode &node);
 
 protected:
     std::vector<std::shared_ptr<STNode>> children;
+
+    /**
+     * @brief Move the nodes held by this node to a vector
+     * @param nodes The vector to append the nodes to
+     */
+    virtual void detach(std::vector<std::shared_ptr<STNode>> &nodes);
+
+    /**
+     * @brief Release nodes one at a time, detaching the nodes held only by them first
+     * @param nodes The nodes to release; emptied on return
+     */
+    static void release(std::vector<std::shared_ptr<STNode>> &nodes);
 };
 
 class TruthValue : public STNode
@@ -103,7 +119,7 @@ public:
     std::string toString() const override;
     std::string toCompleteString() const override;
     std::string getType() const override;
-    void print() const override;
+    void print(const std::function<int(int)> &numbering) const override;
     std::shared_ptr<TruthValue> operator==(std::shared_ptr<String> other) const;
     std::shared_ptr<TruthValue> operator!=(std::shared_ptr<String> other) const;
     std::shared_ptr<TruthValue> operator<(std::shared_ptr<String> other) const;
@@ -123,6 +139,7 @@ class Tuple : public STNode
 public:
     Tuple();
     Tuple(std::vector<std::shared_ptr<STNode>> values);
+    ~Tuple();
     std::vector<std::shared_ptr<STNode>> getValues() const;
 
     /**
@@ -140,7 +157,7 @@ public:
     std::string toString() const override;
     std::string toCompleteString() const override;
     std::string getType() const override;
-    void print() const override;
+    void print(const std::function<int(int)> &numbering) const override;
 
     /**
      * @brief Insert an element to the tuple
@@ -154,22 +171,41 @@ public:
      */
     std::shared_ptr<STNode> operator[](int index) const;
 
+protected:
+    void detach(std::vector<std::shared_ptr<STNode>> &nodes) override;
+
 private:
     std::vector<std::shared_ptr<STNode>> values;
     int size;
+
+    /**
+     * @brief Walk the tuple and its nested tuples in order, without recursion
+     * @param nil The text of an empty tuple
+     * @param text Called with the parentheses and separators
+     * @param element Called with each element that is not a tuple
+     */
+    void traverse(const char *nil, const std::function<void(const char *)> &text,
+                  const std::function<void(const STNode &)> &element) const;
 };
 
 class Identifier : public STNode
 {
 public:
     Identifier(std::string name);
-    std::string getName() const;
+
+    /**
+     * @brief Create an identifier sharing its name with the other identifiers of the same name
+     * @param name The interned name
+     */
+    Identifier(std::shared_ptr<const std::string> name);
+
+    const std::string &getName() const;
     std::string toString() const override;
     std::string toCompleteString() const override;
     std::string getType() const override;
 
 private:
-    std::string name;
+    std::shared_ptr<const std::string> name;
 };
 
 class BinaryOperator : public STNode
@@ -269,7 +305,7 @@ public:
     virtual std::string toString() const override;
     std::string toCompleteString() const override;
     virtual std::string getType() const override;
-    virtual void print() const override;
+    virtual void print(const std::function<int(int)> &numbering) const override;
 
     /**
      * @brief Get the number of bindings stored
@@ -301,6 +337,18 @@ public:
      */
     void setIndex(int index);
 
+    /**
+     * @brief Get the name of the function defined by the lambda
+     * @return The name, or an empty string if the lambda is anonymous
+     */
+    std::string getName() const;
+
+    /**
+     * @brief Set the name of the function defined by the lambda
+     * @param name The name
+     */
+    void setName(std::string name);
+
     /**
      * @brief Get the environment for which lambda is bound to
      * @return The environment
@@ -317,6 +365,7 @@ protected:
     int bindingCount;
     int index;
     int env;
+    std::string name; // name of the function, known for function forms and rec
     std::vector<std::shared_ptr<Identifier>> bindings;
 };
 
@@ -378,6 +427,29 @@ public:
     Beta();
     std::string toString() const override;
     std::string getType() const override;
+
+    /**
+     * @brief Set the deltas to branch to
+     * @param thenIndex The index of delta_then
+     * @param elseIndex The index of delta_else
+     */
+    void setTargets(int thenIndex, int elseIndex);
+
+    /**
+     * @brief Get the index of the delta to load when the condition is true
+     * @return The index of delta_then
+     */
+    int getThenIndex() const;
+
+    /**
+     * @brief Get the index of the delta to load when the condition is false
+     * @return The index of delta_else
+     */
+    int getElseIndex() const;
+
+private:
+    int thenIndex;
+    int elseIndex;
 };
 
 class Equal : public STNode
@@ -441,6 +513,44 @@ private:
     std::shared_ptr<Lambda> l;
 };
 
+enum SuperinstructionKind
+{
+    APPLY_IDENTIFIERS, // gamma <ID> <ID>
+    OPERATE_INTEGER,   // <binary operator> <ID> <INT>
+    BRANCH_INTEGER,    // beta <binary operator> <ID> <INT>
+};
+
+class Superinstruction : public STNode
+{
+public:
+    /**
+     * @brief Construct a superinstruction
+     * @param kind The sequence fused by the superinstruction
+     * @param nodes The fused nodes in the order they appear in the control structure
+     */
+    Superinstruction(SuperinstructionKind kind, std::vector<std::shared_ptr<STNode>> nodes);
+
+    /**
+     * @brief Get the sequence fused by the superinstruction
+     * @return The kind of the superinstruction
+     */
+    SuperinstructionKind getKind() const;
+
+    /**
+     * @brief Get a fused node
+     * @param index The position of the node in the fused sequence
+     * @return The node
+     */
+    const std::shared_ptr<STNode> &getNode(int index) const;
+
+    std::string toString() const override;
+    std::string getType() const override;
+
+private:
+    SuperinstructionKind kind;
+    std::vector<std::shared_ptr<STNode>> nodes;
+};
+
 class Dummy : public STNode
 {
 public:
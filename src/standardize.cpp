@@ -1,5 +1,11 @@
+#include <algorithm>
+#include <climits>
 #include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
+#include "allocation.h"
 #include "ast.h"
 #include "operators.h"
 #include "st.h"
@@ -24,86 +30,181 @@ void bind_lambda(shared_ptr<Lambda> l, vector<shared_ptr<STNode>> toBind, int st
 
 void checkChildrenCount(string nodeStr, int expected, int given);
 
+/**
+ * @brief Name the lambdas of a function definition, so that profiles can show the function instead of the lambda
+ * @param node The outermost lambda of the definition
+ * @param name The name of the function
+ * @param count The number of nested lambdas to name; naming stops earlier at the first node that is not an anonymous lambda
+ */
+void nameLambdas(shared_ptr<STNode> node, const string &name, int count);
+
 shared_ptr<ST> AST::standardize() const
 {
-    return make_shared<ST>(postOrder(root, 0));
+    return make_shared<ST>(postOrder(root));
 }
 
-shared_ptr<STNode> AST::postOrder(shared_ptr<ASTNode> node, int level) const
+shared_ptr<ST> AST::streamStandardize(ASTReader &reader)
+{
+    vector<ASTNode> nodes;                       // nodes whose subtrees are not read completely, from the root down
+    vector<vector<shared_ptr<STNode>>> children; // standardized children of each of those nodes
+    StringTable strings;
+    shared_ptr<STNode> root = nullptr;
+
+    int level;
+    Type type;
+    string_view value;
+    while (reader.next(level, type, value))
+    {
+        // A node is at most one level deeper than the previous node, as a child of it
+        if (level > (int)nodes.size())
+        {
+            cerr << "Error: The AST skips a level\n";
+            exit(EXIT_FAILURE);
+        }
+
+        // A node at this level closes the subtrees of all open nodes at the same or a deeper level
+        while ((int)nodes.size() > level)
+        {
+            shared_ptr<STNode> node = nodes.back().standardize(move(children.back()));
+            nodes.pop_back();
+            children.pop_back();
+
+            if (nodes.empty())
+                root = node;
+            else
+                children.back().push_back(node);
+        }
+
+        if (nodes.empty() && root != nullptr)
+        {
+            cerr << "Error: The AST has more than one root\n";
+            exit(EXIT_FAILURE);
+        }
+
+        ASTNode node;
+        node.type = type;
+        node.value = strings.intern(value);
+        nodes.push_back(node);
+        children.emplace_back();
+    }
+
+    // Close the remaining subtrees up to the root
+    while (!nodes.empty())
+    {
+        shared_ptr<STNode> node = nodes.back().standardize(move(children.back()));
+        nodes.pop_back();
+        children.pop_back();
+
+        if (nodes.empty())
+            root = node;
+        else
+            children.back().push_back(node);
+    }
+
+    return make_shared<ST>(root);
+}
+
+shared_ptr<STNode> AST::postOrder(shared_ptr<ASTNode> node) const
 {
     if (node == nullptr)
     {
         return nullptr;
     }
 
-    vector<shared_ptr<STNode>> children;
-    for (auto child : node->children)
+    // Each frame holds a node, the index of its next child to visit and its standardized children so far
+    struct Frame
+    {
+        const ASTNode *node;
+        size_t next;
+        vector<shared_ptr<STNode>> children;
+    };
+
+    vector<Frame> frames;
+    frames.push_back({node.get(), 0, {}});
+    shared_ptr<STNode> root = nullptr;
+
+    while (!frames.empty())
     {
-        // recursively standardize the children
-        children.push_back(postOrder(child, level + 1));
+        Frame &frame = frames.back();
+        if (frame.next < frame.node->children.size())
+        {
+            const ASTNode *child = frame.node->children[frame.next++].get();
+            frames.push_back({child, 0, {}});
+            continue;
+        }
+
+        shared_ptr<STNode> standardized = frame.node->standardize(move(frame.children)); // standardize the node
+        frames.pop_back();
+
+        if (frames.empty())
+            root = standardized;
+        else
+            frames.back().children.push_back(standardized);
     }
 
-    return node->standardize(children); // standardize the node
+    return root;
 }
 
 shared_ptr<STNode> ASTNode::standardize(vector<shared_ptr<STNode>> children) const
 {
+    const string &value = *this->value;
+
     if (this->type == IDENTIFIER)
     {
-        return make_shared<Identifier>(this->value);
+        return makeNode<Identifier>(this->value);
     }
     else if (this->type == INTEGER)
     {
-        return make_shared<Integer>(this->value);
+        return makeNode<Integer>(value);
     }
     else if (this->type == STRING)
     {
-        return make_shared<String>(this->value);
+        return makeNode<String>(value);
     }
-    else if (this->value == "<true>")
+    else if (value == "<true>")
     {
-        return make_shared<TruthValue>(true);
+        return makeNode<TruthValue>(true);
     }
-    else if (this->value == "<false>")
+    else if (value == "<false>")
     {
-        return make_shared<TruthValue>(false);
+        return makeNode<TruthValue>(false);
     }
-    else if (this->value == "<nil>")
+    else if (value == "<nil>")
     {
-        return make_shared<Tuple>();
+        return makeNode<Tuple>();
     }
 
     // Custom standardizations as in CSE Machine rules
 
-    if (isUnOp(this->value))
+    if (isUnOp(value))
     {
-        checkChildrenCount(this->value, 1, children.size());
-        return make_shared<UnaryOperator>(this->value, children[0]);
+        checkChildrenCount(value, 1, children.size());
+        return makeNode<UnaryOperator>(value, children[0]);
     }
 
-    if (isBinOp(this->value))
+    if (isBinOp(value))
     {
-        checkChildrenCount(this->value, 2, children.size());
-        return make_shared<BinaryOperator>(this->value, children[0], children[1]);
+        checkChildrenCount(value, 2, children.size());
+        return makeNode<BinaryOperator>(value, children[0], children[1]);
     }
 
-    if (this->value == "->")
+    if (value == "->")
     {
         checkChildrenCount("Arrow", 3, children.size());
         vector<shared_ptr<STNode>> newChildren;
-        newChildren.push_back(make_shared<Delta>(children[1])); // delta_then
-        newChildren.push_back(make_shared<Delta>(children[2])); // delta_else
-        newChildren.push_back(make_shared<Beta>());
+        newChildren.push_back(makeNode<Delta>(children[1])); // delta_then
+        newChildren.push_back(makeNode<Delta>(children[2])); // delta_else
+        newChildren.push_back(makeNode<Beta>());
         newChildren.push_back(children[0]);
-        return make_shared<Arrow>(newChildren);
+        return makeNode<Arrow>(newChildren);
     }
 
-    if (this->value == "tau")
+    if (value == "tau")
     {
-        return make_shared<Tau>(children);
+        return makeNode<Tau>(children);
     }
 
-    if (this->value == "function_form")
+    if (value == "function_form")
     {
         if ((int)children.size() < 3)
         {
@@ -113,16 +214,18 @@ shared_ptr<STNode> ASTNode::standardize(vector<shared_ptr<STNode>> children) con
 
         auto p = children[0];
 
-        shared_ptr<Lambda> l = make_shared<Lambda>();
+        shared_ptr<Lambda> l = makeNode<Lambda>();
         bind_lambda(l, children, 1); // bind the identifiers and comma nodes to the lambda
+        if (p->getType() == "Identifier")
+            nameLambdas(l, static_pointer_cast<Identifier>(p)->getName(), children.size() - 2);
 
-        shared_ptr<Equal> eq = make_shared<Equal>();
+        shared_ptr<Equal> eq = makeNode<Equal>();
         eq->addChild(p);
         eq->addChild(l);
         return eq;
     }
 
-    if (this->value == "lambda")
+    if (value == "lambda")
     {
         if ((int)children.size() < 2)
         {
@@ -130,17 +233,17 @@ shared_ptr<STNode> ASTNode::standardize(vector<shared_ptr<STNode>> children) con
             exit(EXIT_FAILURE);
         }
 
-        shared_ptr<Lambda> l = make_shared<Lambda>();
+        shared_ptr<Lambda> l = makeNode<Lambda>();
         bind_lambda(l, children, 0); // bind the identifiers and comma nodes to the lambda
         return l;
     }
 
     // Standardizations as in RPAL Semantics
 
-    if (this->value == "and")
+    if (value == "and")
     {
-        shared_ptr<Equal> eq = make_shared<Equal>();
-        shared_ptr<Comma> comma = make_shared<Comma>();
+        shared_ptr<Equal> eq = makeNode<Equal>();
+        shared_ptr<Comma> comma = makeNode<Comma>();
         vector<shared_ptr<STNode>> e_s;
 
         for (auto child : children)
@@ -157,18 +260,18 @@ shared_ptr<STNode> ASTNode::standardize(vector<shared_ptr<STNode>> children) con
             e_s.push_back(child_children[1]);   // add the value to the tau node
         }
 
-        shared_ptr<Tau> t = make_shared<Tau>(e_s); // create the tau node
+        shared_ptr<Tau> t = makeNode<Tau>(e_s); // create the tau node
 
         eq->addChild(comma);
         eq->addChild(t);
         return eq;
     }
 
-    if (this->value == "@")
+    if (value == "@")
     {
         checkChildrenCount("@", 3, children.size());
-        shared_ptr<Gamma> g_1 = make_shared<Gamma>();
-        shared_ptr<Gamma> g_2 = make_shared<Gamma>();
+        shared_ptr<Gamma> g_1 = makeNode<Gamma>();
+        shared_ptr<Gamma> g_2 = makeNode<Gamma>();
         g_2->addChild(children[1]);
         g_2->addChild(children[0]);
         g_1->addChild(g_2);
@@ -176,7 +279,7 @@ shared_ptr<STNode> ASTNode::standardize(vector<shared_ptr<STNode>> children) con
         return g_1;
     }
 
-    if (this->value == "rec")
+    if (value == "rec")
     {
         checkChildrenCount("Rec", 1, children.size());
 
@@ -190,12 +293,19 @@ shared_ptr<STNode> ASTNode::standardize(vector<shared_ptr<STNode>> children) con
         auto x = child_children[0];
         auto e = child_children[1];
 
-        shared_ptr<Equal> eq = make_shared<Equal>();
-        shared_ptr<Gamma> g = make_shared<Gamma>();
-        shared_ptr<Lambda> l = make_shared<Lambda>();
-        shared_ptr<YStar> y = make_shared<YStar>();
+        shared_ptr<Equal> eq = makeNode<Equal>();
+        shared_ptr<Gamma> g = makeNode<Gamma>();
+        shared_ptr<Lambda> l = makeNode<Lambda>();
+        shared_ptr<YStar> y = makeNode<YStar>();
 
         bind_lambda(l, x, e);
+        if (x->getType() == "Identifier")
+        {
+            // The lambda applied to Y* returns the function on each recursive call and is labeled apart from it
+            string name = static_pointer_cast<Identifier>(x)->getName();
+            l->setName(name + " (rec)");
+            nameLambdas(e, name, INT_MAX);
+        }
         g->addChild(y);
         g->addChild(l);
         eq->addChild(x);
@@ -204,7 +314,7 @@ shared_ptr<STNode> ASTNode::standardize(vector<shared_ptr<STNode>> children) con
         return eq;
     }
 
-    if (this->value == "within")
+    if (value == "within")
     {
         checkChildrenCount("Within", 2, children.size());
 
@@ -222,9 +332,9 @@ shared_ptr<STNode> ASTNode::standardize(vector<shared_ptr<STNode>> children) con
         auto x_2 = children_2[0];
         auto e_2 = children_2[1];
 
-        shared_ptr<Equal> eq = make_shared<Equal>();
-        shared_ptr<Gamma> g = make_shared<Gamma>();
-        shared_ptr<Lambda> l = make_shared<Lambda>();
+        shared_ptr<Equal> eq = makeNode<Equal>();
+        shared_ptr<Gamma> g = makeNode<Gamma>();
+        shared_ptr<Lambda> l = makeNode<Lambda>();
 
         bind_lambda(l, x_1, e_2);
         g->addChild(l);
@@ -235,7 +345,7 @@ shared_ptr<STNode> ASTNode::standardize(vector<shared_ptr<STNode>> children) con
         return eq;
     }
 
-    if (this->value == "where")
+    if (value == "where")
     {
         checkChildrenCount("Where", 2, children.size());
 
@@ -250,8 +360,8 @@ shared_ptr<STNode> ASTNode::standardize(vector<shared_ptr<STNode>> children) con
         auto x = children_eq[0];
         auto e = children_eq[1];
 
-        shared_ptr<Gamma> g = make_shared<Gamma>();
-        shared_ptr<Lambda> l = make_shared<Lambda>();
+        shared_ptr<Gamma> g = makeNode<Gamma>();
+        shared_ptr<Lambda> l = makeNode<Lambda>();
 
         bind_lambda(l, x, p);
         g->addChild(l);
@@ -260,7 +370,7 @@ shared_ptr<STNode> ASTNode::standardize(vector<shared_ptr<STNode>> children) con
         return g;
     }
 
-    if (this->value == "let")
+    if (value == "let")
     {
         checkChildrenCount("Let", 2, children.size());
 
@@ -275,8 +385,8 @@ shared_ptr<STNode> ASTNode::standardize(vector<shared_ptr<STNode>> children) con
         auto e = children_eq[1];
         auto p = children[1];
 
-        shared_ptr<Gamma> g = make_shared<Gamma>();
-        shared_ptr<Lambda> l = make_shared<Lambda>();
+        shared_ptr<Gamma> g = makeNode<Gamma>();
+        shared_ptr<Lambda> l = makeNode<Lambda>();
 
         bind_lambda(l, x, p);
         g->addChild(l);
@@ -285,18 +395,18 @@ shared_ptr<STNode> ASTNode::standardize(vector<shared_ptr<STNode>> children) con
         return g;
     }
 
-    if (this->value == "gamma")
+    if (value == "gamma")
     {
         checkChildrenCount("Gamma", 2, children.size());
-        shared_ptr<Gamma> g = make_shared<Gamma>();
+        shared_ptr<Gamma> g = makeNode<Gamma>();
         g->addChild(children[0]);
         g->addChild(children[1]);
         return g;
     }
 
-    if (this->value == ",")
+    if (value == ",")
     {
-        shared_ptr<Comma> c = make_shared<Comma>();
+        shared_ptr<Comma> c = makeNode<Comma>();
         for (auto child : children)
         {
             c->addChild(child);
@@ -304,16 +414,16 @@ shared_ptr<STNode> ASTNode::standardize(vector<shared_ptr<STNode>> children) con
         return c;
     }
 
-    if (this->value == "=")
+    if (value == "=")
     {
         checkChildrenCount("Equal", 2, children.size());
-        shared_ptr<Equal> eq = make_shared<Equal>();
+        shared_ptr<Equal> eq = makeNode<Equal>();
         eq->addChild(children[0]);
         eq->addChild(children[1]);
         return eq;
     }
 
-    cerr << "Unknown node type: " << this->value << "\n";
+    cerr << "Unknown node type: " << value << "\n";
     exit(EXIT_FAILURE);
 }
 
@@ -380,7 +490,7 @@ void bind_lambda(shared_ptr<Lambda> l, vector<shared_ptr<STNode>> toBind, int st
             else
             {
                 // if not the last identifier or comma node, create a new lambda node and bind the identifier(s) to it
-                auto p = make_shared<Lambda>();
+                auto p = makeNode<Lambda>();
                 bind_lambda(w, b, p);
                 w = p; // set the current lambda node to the new lambda node to continue building the tree
             }
@@ -396,3 +506,16 @@ void checkChildrenCount(string nodeStr, int expected, int given)
         exit(EXIT_FAILURE);
     }
 }
+
+void nameLambdas(shared_ptr<STNode> node, const string &name, int count)
+{
+    for (int i = 0; i < count && node->getType() == "Lambda"; ++i)
+    {
+        shared_ptr<Lambda> l = static_pointer_cast<Lambda>(node);
+        if (!l->getName().empty())
+            break;
+
+        l->setName(name);
+        node = l->getChildren()[0];
+    }
+}
@@ -0,0 +1,94 @@
+#include <iomanip>
+#include <iostream>
+#include "stats.h"
+#include "timeline.h"
+
+using namespace std;
+
+static const char *const PHASE_NAMES[] = {"load", "ast", "standardize", "generate", "execute"};
+
+// Names of the phases in the timeline, where building the AST is shown as parsing
+static const char *const TIMELINE_NAMES[] = {"load", "parse", "standardize", "generate", "execute"};
+
+void Statistics::print(ostream &os, bool json, double total) const
+{
+    long steps = 0;
+    for (long count : rules)
+    {
+        steps += count;
+    }
+
+    if (json)
+    {
+        os << "{\"steps\": " << steps << ", \"rules\": {";
+        for (int rule = 1; rule <= 13; ++rule)
+        {
+            os << "\"" << rule << "\": " << rules[rule] << (rule == 13 ? "" : ", ");
+        }
+        os << "}, \"allocations\": {\"environments\": " << environments << ", \"closures\": " << closures
+           << ", \"tuples\": " << tuples << ", \"strings\": " << strings << "}";
+        os << ", \"peak\": {\"control\": " << peakControl << ", \"stack\": " << peakStack << "}";
+        os << ", \"phases\": {";
+        for (int phase = 0; phase < PHASE_COUNT; ++phase)
+        {
+            os << "\"" << PHASE_NAMES[phase] << "\": ";
+            if (ran[phase])
+                os << fixed << setprecision(6) << times[phase];
+            else
+                os << "null";
+            os << ", ";
+        }
+        os << "\"total\": " << fixed << setprecision(6) << total << "}}\n";
+        return;
+    }
+
+    os << "Steps: " << steps << "\n";
+    for (int rule = 1; rule <= 13; ++rule)
+    {
+        os << setw(10) << ("Rule " + to_string(rule)) << ": " << setw(12) << rules[rule] << setw(7) << fixed << setprecision(1)
+           << (steps == 0 ? 0.0 : 100.0 * rules[rule] / steps) << "%\n";
+    }
+    os << "Allocations: " << environments << " environments, " << closures << " closures, " << tuples << " tuples, " << strings
+       << " strings\n";
+    os << "Peak depth: " << peakControl << " on the control, " << peakStack << " on the stack\n";
+    os << "Time (ms):";
+    for (int phase = 0; phase < PHASE_COUNT; ++phase)
+    {
+        if (ran[phase])
+            os << " " << PHASE_NAMES[phase] << " " << fixed << setprecision(3) << times[phase] * 1000 << ",";
+    }
+    os << " total " << fixed << setprecision(3) << total * 1000 << "\n";
+}
+
+PhaseTimer::PhaseTimer(Statistics *statistics, Statistics::Phase phase)
+{
+    this->statistics = statistics;
+    this->timeline = Timeline::active;
+    this->phase = phase;
+    if (statistics != nullptr || timeline != nullptr)
+        this->start = chrono::steady_clock::now();
+}
+
+PhaseTimer::~PhaseTimer()
+{
+    stop();
+}
+
+void PhaseTimer::stop()
+{
+    if (statistics == nullptr && timeline == nullptr)
+        return;
+
+    auto end = chrono::steady_clock::now();
+    if (statistics != nullptr)
+    {
+        statistics->times[phase] += chrono::duration<double>(end - start).count();
+        statistics->ran[phase] = true;
+        statistics = nullptr;
+    }
+    if (timeline != nullptr)
+    {
+        timeline->phase(TIMELINE_NAMES[phase], start, end);
+        timeline = nullptr;
+    }
+}
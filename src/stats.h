@@ -0,0 +1,72 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+
+class Timeline;
+
+// Counters and timings of a run, printed with -stats
+struct Statistics
+{
+    enum Phase
+    {
+        LOAD,        // reading the input file, or the cached program
+        AST,         // building the AST; only separate from standardizing when the AST is printed
+        STANDARDIZE, // building the ST
+        GENERATE,    // generating the control structures, also when they are generated during execution
+        EXECUTE,     // running the CSE machine, without the generation of control structures
+        PHASE_COUNT
+    };
+
+    long rules[14] = {};            // number of applications of each CSE rule, by rule number
+    long environments = 0;          // environments created, including the primitive environment
+    long closures = 0;              // lambda closures and eta closures created
+    long tuples = 0;                // tuples created
+    long strings = 0;               // strings created
+    std::size_t peakControl = 0;    // highest number of elements on the control
+    std::size_t peakStack = 0;      // highest number of elements on the stack
+    double times[PHASE_COUNT] = {}; // seconds spent in each phase
+    bool ran[PHASE_COUNT] = {};     // whether each phase ran
+
+    /**
+     * @brief Print the statistics
+     * @param os The output stream to write to
+     * @param json Whether to print JSON instead of text
+     * @param total The wall time of the whole run in seconds
+     */
+    void print(std::ostream &os, bool json, double total) const;
+};
+
+/**
+ * Adds the time between its construction and destruction to a phase, and writes it as a span of the active timeline.
+ * Does nothing if there are neither statistics nor a timeline, so it can be placed on paths that run without -stats.
+ */
+class PhaseTimer
+{
+public:
+    /**
+     * @brief Start timing a phase
+     * @param statistics The statistics to add the time to, or nullptr
+     * @param phase The phase
+     */
+    PhaseTimer(Statistics *statistics, Statistics::Phase phase);
+    ~PhaseTimer();
+
+    /**
+     * @brief Stop timing before the timer is destroyed
+     */
+    void stop();
+
+    PhaseTimer(const PhaseTimer &) = delete;
+    PhaseTimer &operator=(const PhaseTimer &) = delete;
+
+private:
+    Statistics *statistics;
+    Timeline *timeline;
+    Statistics::Phase phase;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif // STATS_H
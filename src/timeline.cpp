@@ -0,0 +1,75 @@
+#include <iomanip>
+#include <string>
+#include "profile.h"
+#include "timeline.h"
+
+using namespace std;
+
+Timeline *Timeline::active = nullptr;
+
+Timeline::Timeline(string filename, long threshold) : out(filename)
+{
+    this->origin = chrono::steady_clock::now();
+    this->threshold = chrono::microseconds(threshold);
+    this->empty = true;
+    out << "[";
+}
+
+Timeline::~Timeline()
+{
+    close();
+}
+
+void Timeline::phase(const char *name, chrono::steady_clock::time_point start, chrono::steady_clock::time_point end)
+{
+    write(name, "phase", start, end);
+}
+
+void Timeline::enter(const Lambda &l, int number)
+{
+    int delta = l.getIndex();
+    if (delta >= (int)labels.size())
+        labels.resize(delta + 1);
+    if (labels[delta].empty())
+        labels[delta] = getFunctionLabel(l, number);
+    calls.push_back({delta, chrono::steady_clock::now()});
+}
+
+void Timeline::leave()
+{
+    // The primitive environment is exited last, without a call
+    if (calls.empty())
+        return;
+
+    auto end = chrono::steady_clock::now();
+    if (end - calls.back().second >= threshold)
+        write(labels[calls.back().first], "call", calls.back().second, end);
+    calls.pop_back();
+}
+
+void Timeline::close()
+{
+    if (!out.is_open())
+        return;
+
+    // The calls still running when the execution fails end with it
+    auto end = chrono::steady_clock::now();
+    while (!calls.empty())
+    {
+        write(labels[calls.back().first], "call", calls.back().second, end);
+        calls.pop_back();
+    }
+    out << "\n]\n";
+    out.close();
+}
+
+void Timeline::write(const string &name, const char *category, chrono::steady_clock::time_point start,
+                     chrono::steady_clock::time_point end)
+{
+    // Times are in microseconds; the phases and the calls are on one track, where they nest
+    out << (empty ? "\n" : ",\n") << "{\"name\": \"" << name << "\", \"cat\": \"" << category
+        << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": " << fixed << setprecision(3)
+        << chrono::duration<double, micro>(start - origin).count()
+        << ", \"dur\": " << chrono::duration<double, micro>(end - start).count() << "}";
+    empty = false;
+}
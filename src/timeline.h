@@ -0,0 +1,74 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "st_types.h"
+
+/**
+ * Writes a timeline of the run in the trace event format of Chrome, which chrome://tracing and Perfetto open: a span for
+ * each phase of the interpreter and for each call of an RPAL function that lasted at least a threshold. The spans are
+ * written as they end, in the JSON array form whose closing bracket may be missing, so the file of a failed run can still
+ * be opened.
+ */
+class Timeline
+{
+public:
+    static Timeline *active; // the timeline the phases are recorded in, nullptr if none
+
+    /**
+     * @brief Create a timeline; times are measured from its creation
+     * @param filename The name of the file to write
+     * @param threshold The shortest call written, in microseconds
+     */
+    Timeline(std::string filename, long threshold);
+    ~Timeline();
+
+    /**
+     * @brief Write a span of a phase
+     * @param name The name of the phase
+     * @param start The start of the phase
+     * @param end The end of the phase
+     */
+    void phase(const char *name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+    /**
+     * @brief Record that a function was entered
+     * @param l The applied lambda
+     * @param number The index of the lambda in a full generation of the control structures
+     */
+    void enter(const Lambda &l, int number);
+
+    /**
+     * @brief Record that the current function was exited, writing its span if it lasted at least the threshold
+     */
+    void leave();
+
+    /**
+     * @brief End the calls still running and close the file
+     */
+    void close();
+
+private:
+    std::ofstream out;
+    std::chrono::steady_clock::time_point origin;
+    std::chrono::steady_clock::duration threshold;
+    bool empty;                                                               // whether no event was written yet
+    std::vector<std::pair<int, std::chrono::steady_clock::time_point>> calls; // delta index and start of the running calls
+    std::vector<std::string> labels;                                          // label of each entered lambda, by delta index
+
+    /**
+     * @brief Write a complete event
+     * @param name The name of the span
+     * @param category The category of the span
+     * @param start The start of the span
+     * @param end The end of the span
+     */
+    void write(const std::string &name, const char *category, std::chrono::steady_clock::time_point start,
+               std::chrono::steady_clock::time_point end);
+};
+
+#endif // TIMELINE_H
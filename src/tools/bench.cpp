@@ -0,0 +1,670 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+// Name of the file the program of each run is written to
+static const string INPUT_FILE = "bench_input";
+
+// Directory the named baselines are stored in
+static const string BASELINE_DIRECTORY = "baselines";
+
+// Number of times a benchmark that got slower than the baseline is measured again
+static const int RETRIES = 2;
+
+// Shortest execution in seconds whose speed is compared; shorter ones vary too much from run to run
+static const double MIN_TIMED = 0.1;
+
+// A workload of the suite and the sizes it is run at
+struct Workload
+{
+    string name;
+    vector<long> sizes; // empty if the program is run as it is
+};
+
+// The measurements of a single run of the interpreter
+struct Run
+{
+    bool succeeded;
+    string errors; // what the interpreter wrote to stderr
+    double wall;   // wall time of the whole process in seconds
+    long peakRSS;  // peak resident set size in KB
+};
+
+// The results of a workload at one size
+struct Result
+{
+    string name;
+    long size; // -1 if the program was run as it is
+    long steps;
+    vector<double> walls;    // wall time of each run in seconds
+    vector<double> executes; // time of the execution phase of each run in seconds
+    double peakRSS;          // median peak resident set size in KB
+    long nodes;              // nodes allocated
+    long bytes;              // bytes of the allocated nodes
+    long peakLiveBytes;      // most bytes of nodes alive at once
+};
+
+// How much worse a result may get before it is a regression, as fractions of the baseline
+struct Thresholds
+{
+    double speed = 0.10;       // drop of the steps per second
+    double rss = 0.10;         // growth of the peak RSS
+    double allocations = 0.01; // growth of the allocated nodes or bytes
+};
+
+/**
+ * @brief Read the list of workloads
+ * @param filename The name of the file; each line is the name of a workload followed by its sizes
+ * @param workloads Set to the workloads in the file
+ * @return true if the file is valid, false otherwise
+ */
+bool readWorkloads(const string &filename, vector<Workload> &workloads);
+
+/**
+ * @brief Set the size of a workload in its program
+ * @param program The lines of the program, which starts with "let size = N in"
+ * @param size The size to put in place of N
+ * @return true if the program binds the size, false otherwise
+ */
+bool setSize(vector<string> &program, long size);
+
+/**
+ * @brief Run the interpreter on the input file, discarding what the program prints
+ * @param interpreter The path of the interpreter
+ * @param arguments The arguments given before the input file
+ * @return The measurements of the run
+ */
+Run runInterpreter(const string &interpreter, const vector<string> &arguments);
+
+/**
+ * @brief Run the program in the input file and measure it
+ * @param interpreter The path of the interpreter
+ * @param runs The number of timed runs
+ * @param result The result to fill in; the name and the size are already set
+ * @return true if all the runs succeeded, false otherwise
+ */
+bool measure(const string &interpreter, int runs, Result &result);
+
+/**
+ * @brief Write results as JSON, a benchmark per line
+ * @param os The output stream to write to
+ * @param interpreter The path of the interpreter
+ * @param runs The number of timed runs of each benchmark
+ * @param results The results
+ */
+void writeResults(ostream &os, const string &interpreter, int runs, const vector<Result> &results);
+
+/**
+ * @brief Read results written by writeResults
+ * @param filename The name of the file
+ * @param results Set to the results in the file
+ * @return true if the file was read, false otherwise
+ */
+bool readResults(const string &filename, vector<Result> &results);
+
+/**
+ * @brief Find the result of the same workload and size
+ * @param results The results to search
+ * @param result The result to look for
+ * @return The matching result, or nullptr if there is none
+ */
+const Result *findResult(const vector<Result> &results, const Result &result);
+
+/**
+ * @brief Check whether the execution got slower than in the baseline
+ * @param old The result of the baseline
+ * @param result The new result
+ * @param thresholds How much worse a result may get
+ * @return true if the steps per second regressed, false otherwise
+ */
+bool isSlower(const Result &old, const Result &result, const Thresholds &thresholds);
+
+/**
+ * @brief Compare results with a baseline and print the changes
+ * @param baseline The results of the baseline
+ * @param results The new results
+ * @param thresholds How much worse a result may get
+ * @return The number of regressions
+ */
+int compare(const vector<Result> &baseline, const vector<Result> &results, const Thresholds &thresholds);
+
+/**
+ * @brief Find a number in the output of the interpreter
+ * @param text The output
+ * @param key The text right before the number
+ * @param after Text that comes before the key, or empty to search from the start
+ * @return The number, or -1 if the key is not found
+ */
+double findNumber(const string &text, const string &key, const string &after = "");
+
+/**
+ * @brief Read a JSON array of numbers
+ * @param text The text containing the array
+ * @param key The text right before the array
+ * @return The numbers, empty if the key is not found
+ */
+vector<double> findNumbers(const string &text, const string &key);
+
+/**
+ * @brief Get the median of some numbers
+ * @param numbers The numbers; there is at least one
+ * @return The median
+ */
+double median(vector<double> numbers);
+
+/**
+ * @brief Get the steps per second of the execution phase
+ * @param result The result
+ * @return The steps per second in the median run
+ */
+double getSpeed(const Result &result);
+
+/**
+ * @brief Get the steps per second of the execution phase in the fastest run
+ * @param result The result
+ * @return The steps per second
+ */
+double getBestSpeed(const Result &result);
+
+/**
+ * @brief Get how much the execution times of the runs spread above the fastest one
+ * @param result The result
+ * @return The difference between the median and the fastest run, as a fraction of the median
+ */
+double getSpread(const Result &result);
+
+int main(int argc, char *argv[])
+{
+    string interpreter = "./myrpal";
+    string directory = "bench";
+    string outputFile;
+    string save;       // name of the baseline to store the results as
+    string baseline;   // name of the baseline to compare the results with
+    string resultFile; // results to compare instead of running the benchmarks
+    int runs = 3;
+    Thresholds thresholds;
+    vector<string> selected;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "-interpreter" && i + 1 < argc)
+        {
+            interpreter = argv[++i];
+        }
+        else if (arg == "-dir" && i + 1 < argc)
+        {
+            directory = argv[++i];
+        }
+        else if (arg == "-o" && i + 1 < argc)
+        {
+            outputFile = argv[++i];
+        }
+        else if (arg == "-runs" && i + 1 < argc)
+        {
+            runs = atoi(argv[++i]);
+            if (runs <= 0)
+            {
+                cerr << "Invalid number of runs: " << argv[i] << "\n";
+                return 1;
+            }
+        }
+        else if ((arg == "-save" || arg == "-compare") && i + 1 < argc)
+        {
+            string name = argv[++i];
+            if (name.empty() || name.find('/') != string::npos)
+            {
+                cerr << "Invalid baseline name: " << name << "\n";
+                return 1;
+            }
+            (arg == "-save" ? save : baseline) = name;
+        }
+        else if (arg == "-results" && i + 1 < argc)
+        {
+            resultFile = argv[++i];
+        }
+        else if ((arg == "-max-slowdown" || arg == "-max-rss" || arg == "-max-alloc") && i + 1 < argc)
+        {
+            double percent = atof(argv[++i]);
+            if (percent <= 0)
+            {
+                cerr << "Invalid threshold: " << argv[i] << "\n";
+                return 1;
+            }
+            (arg == "-max-slowdown" ? thresholds.speed : arg == "-max-rss" ? thresholds.rss : thresholds.allocations) = percent / 100;
+        }
+        else if (arg[0] == '-')
+        {
+            cerr << "Usage: rpal-bench [-interpreter path] [-dir directory] [-runs n] [-o file] [-save name] [-compare name]\n"
+                 << "                  [-results file] [-max-slowdown percent] [-max-rss percent] [-max-alloc percent] [workload ...]\n";
+            return 1;
+        }
+        else
+        {
+            selected.push_back(arg);
+        }
+    }
+
+    vector<Result> baselineResults;
+    if (!baseline.empty() && !readResults(BASELINE_DIRECTORY + "/" + baseline + ".json", baselineResults))
+        return 1;
+
+    vector<Result> results;
+    bool failed = false;
+    if (!resultFile.empty())
+    {
+        if (!readResults(resultFile, results))
+            return 1;
+    }
+    else
+    {
+        vector<Workload> workloads;
+        if (!readWorkloads(directory + "/sizes", workloads))
+            return 1;
+
+        for (const Workload &workload : workloads)
+        {
+            if (!selected.empty() && find(selected.begin(), selected.end(), workload.name) == selected.end())
+                continue;
+
+            ifstream file(directory + "/" + workload.name);
+            if (!file)
+            {
+                cerr << "File not found: " << directory << "/" << workload.name << "\n";
+                return 1;
+            }
+            vector<string> program;
+            for (string line; getline(file, line);)
+                program.push_back(line);
+
+            vector<long> sizes = workload.sizes.empty() ? vector<long>{-1} : workload.sizes;
+            for (long size : sizes)
+            {
+                if (size >= 0 && !setSize(program, size))
+                {
+                    cerr << "Error: " << workload.name << " does not start with \"let size = N in\"\n";
+                    return 1;
+                }
+
+                ofstream input(INPUT_FILE);
+                for (const string &line : program)
+                    input << line << "\n";
+                input.close();
+
+                Result result{};
+                result.name = workload.name;
+                result.size = size;
+                if (!measure(interpreter, runs, result))
+                {
+                    failed = true;
+                    continue;
+                }
+
+                // A slowdown is measured again before it is reported, since the machine can be busy for longer than
+                // the runs take; the new runs are added to the old ones
+                const Result *old = findResult(baselineResults, result);
+                for (int retry = 0; retry < RETRIES && old != nullptr && isSlower(*old, result, thresholds); ++retry)
+                {
+                    cerr << result.name << (size >= 0 ? " " + to_string(size) : "") << " is slower than the baseline, measuring again\n";
+                    Result again = result;
+                    again.walls.clear();
+                    again.executes.clear();
+                    if (!measure(interpreter, runs, again))
+                        break;
+                    result.walls.insert(result.walls.end(), again.walls.begin(), again.walls.end());
+                    result.executes.insert(result.executes.end(), again.executes.begin(), again.executes.end());
+                }
+
+                cerr << left << setw(16) << result.name << right << setw(8) << (size >= 0 ? to_string(size) : "") << setw(12)
+                     << result.steps << " steps" << setw(10) << fixed << setprecision(3) << median(result.walls) << "s"
+                     << setw(12) << setprecision(0) << getSpeed(result) << " steps/s\n";
+                results.push_back(result);
+            }
+        }
+        remove(INPUT_FILE.c_str());
+
+        ostringstream json;
+        writeResults(json, interpreter, runs, results);
+        if (!save.empty())
+        {
+            error_code error;
+            filesystem::create_directories(BASELINE_DIRECTORY, error);
+            outputFile = BASELINE_DIRECTORY + "/" + save + ".json";
+        }
+        if (outputFile.empty() && baseline.empty())
+        {
+            cout << json.str();
+        }
+        else if (!outputFile.empty())
+        {
+            ofstream output(outputFile);
+            output << json.str();
+            if (!output)
+            {
+                cerr << "Error: Could not write " << outputFile << "\n";
+                return 1;
+            }
+        }
+    }
+
+    if (!baseline.empty() && compare(baselineResults, results, thresholds) > 0)
+        return 1;
+    return failed ? 1 : 0;
+}
+
+bool readWorkloads(const string &filename, vector<Workload> &workloads)
+{
+    ifstream file(filename);
+    if (!file)
+    {
+        cerr << "File not found: " << filename << "\n";
+        return false;
+    }
+
+    for (string line; getline(file, line);)
+    {
+        istringstream words(line);
+        Workload workload;
+        if (!(words >> workload.name))
+            continue;
+        for (long size; words >> size;)
+            workload.sizes.push_back(size);
+        if (!words.eof())
+        {
+            cerr << "Invalid line in " << filename << ": " << line << "\n";
+            return false;
+        }
+        workloads.push_back(workload);
+    }
+    return true;
+}
+
+bool setSize(vector<string> &program, long size)
+{
+    if (program.size() < 4 || program[0].rfind("let", 0) != 0 || program[1].rfind(".=", 0) != 0 ||
+        program[2].rfind("..<ID:size>", 0) != 0)
+        return false;
+
+    program[3] = "..<INT:" + to_string(size) + ">";
+    return true;
+}
+
+Run runInterpreter(const string &interpreter, const vector<string> &arguments)
+{
+    Run run = {false, "", 0, 0};
+    int errors[2];
+    if (pipe(errors) != 0)
+    {
+        run.errors = "Could not create a pipe\n";
+        return run;
+    }
+
+    auto start = chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        dup2(errors[1], STDERR_FILENO);
+        close(errors[0]);
+
+        vector<char *> argv;
+        argv.push_back(const_cast<char *>(interpreter.c_str()));
+        for (const string &argument : arguments)
+            argv.push_back(const_cast<char *>(argument.c_str()));
+        argv.push_back(const_cast<char *>(INPUT_FILE.c_str()));
+        argv.push_back(nullptr);
+        execv(interpreter.c_str(), argv.data());
+        perror(interpreter.c_str());
+        _exit(127);
+    }
+    close(errors[1]);
+
+    char buffer[4096];
+    for (ssize_t n; (n = read(errors[0], buffer, sizeof(buffer))) > 0;)
+        run.errors.append(buffer, n);
+    close(errors[0]);
+
+    int status = 0;
+    struct rusage usage;
+    if (pid < 0 || wait4(pid, &status, 0, &usage) != pid)
+    {
+        run.errors += "Could not run " + interpreter + "\n";
+        return run;
+    }
+
+    run.wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    run.peakRSS = usage.ru_maxrss;
+    run.succeeded = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    return run;
+}
+
+bool measure(const string &interpreter, int runs, Result &result)
+{
+    // The runs that are timed only collect the statistics; the allocations are counted in a separate run because
+    // counting them slows the interpreter down
+    vector<double> peaks;
+    Run run{};
+    for (int i = 0; i < runs; ++i)
+    {
+        run = runInterpreter(interpreter, {"-stats=json"});
+        if (!run.succeeded)
+            break;
+        result.steps = findNumber(run.errors, "\"steps\": ");
+        result.walls.push_back(run.wall);
+        result.executes.push_back(findNumber(run.errors, "\"execute\": "));
+        peaks.push_back(run.peakRSS);
+    }
+    if (run.succeeded)
+        run = runInterpreter(interpreter, {"-alloc"});
+    if (!run.succeeded)
+    {
+        cerr << "Error: " << result.name << (result.size >= 0 ? " " + to_string(result.size) : "") << " failed\n"
+             << run.errors;
+        return false;
+    }
+
+    result.peakRSS = median(peaks);
+    result.nodes = findNumber(run.errors, "Allocations: ");
+    result.bytes = findNumber(run.errors, " nodes, ");
+    result.peakLiveBytes = findNumber(run.errors, " nodes, ", "Live at most: ");
+    return true;
+}
+
+void writeResults(ostream &os, const string &interpreter, int runs, const vector<Result> &results)
+{
+    os << fixed << "{\"interpreter\": \"" << interpreter << "\", \"runs\": " << runs << ", \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result &result = results[i];
+        os << (i == 0 ? "" : ",") << "\n  {\"name\": \"" << result.name << "\", \"size\": ";
+        if (result.size >= 0)
+            os << result.size;
+        else
+            os << "null";
+        os << setprecision(6) << ", \"steps\": " << result.steps << ", \"wall\": " << median(result.walls) << ", \"walls\": [";
+        for (size_t j = 0; j < result.walls.size(); ++j)
+            os << (j == 0 ? "" : ", ") << result.walls[j];
+        os << "], \"execute\": " << median(result.executes) << ", \"executes\": [";
+        for (size_t j = 0; j < result.executes.size(); ++j)
+            os << (j == 0 ? "" : ", ") << result.executes[j];
+        os << "], \"steps_per_second\": " << setprecision(0) << getSpeed(result) << ", \"peak_rss_kb\": " << result.peakRSS
+           << ", \"allocations\": {\"nodes\": " << result.nodes << ", \"bytes\": " << result.bytes
+           << ", \"peak_live_bytes\": " << result.peakLiveBytes << "}}";
+    }
+    os << "\n]}\n";
+}
+
+bool readResults(const string &filename, vector<Result> &results)
+{
+    ifstream file(filename);
+    if (!file)
+    {
+        cerr << "File not found: " << filename << "\n";
+        return false;
+    }
+
+    // Each benchmark is on a line of its own, as writeResults writes them
+    const string nameKey = "{\"name\": \"";
+    for (string line; getline(file, line);)
+    {
+        size_t start = line.find(nameKey);
+        if (start == string::npos)
+            continue;
+        start += nameKey.length();
+
+        Result result{};
+        result.name = line.substr(start, line.find('"', start) - start);
+        result.size = line.find("\"size\": null") != string::npos ? -1 : (long)findNumber(line, "\"size\": ");
+        result.steps = findNumber(line, "\"steps\": ");
+        result.walls = findNumbers(line, "\"walls\": [");
+        result.executes = findNumbers(line, "\"executes\": [");
+        result.peakRSS = findNumber(line, "\"peak_rss_kb\": ");
+        result.nodes = findNumber(line, "\"nodes\": ");
+        result.bytes = findNumber(line, "\"bytes\": ");
+        result.peakLiveBytes = findNumber(line, "\"peak_live_bytes\": ");
+        if (result.walls.empty() || result.executes.empty())
+        {
+            cerr << "Invalid results in " << filename << ": " << line << "\n";
+            return false;
+        }
+        results.push_back(result);
+    }
+    return true;
+}
+
+const Result *findResult(const vector<Result> &results, const Result &result)
+{
+    for (const Result &item : results)
+    {
+        if (item.name == result.name && item.size == result.size)
+            return &item;
+    }
+    return nullptr;
+}
+
+bool isSlower(const Result &old, const Result &result, const Thresholds &thresholds)
+{
+    if (*min_element(old.executes.begin(), old.executes.end()) < MIN_TIMED)
+        return false;
+
+    // The fastest runs are the least disturbed by other work on the machine, so they are compared, allowing for how far
+    // the runs of either side spread above their fastest one. The median runs must have slowed down past the threshold
+    // too, so that a single lucky run of the baseline cannot fail the comparison
+    double best = (getBestSpeed(result) - getBestSpeed(old)) / getBestSpeed(old);
+    double typical = (getSpeed(result) - getSpeed(old)) / getSpeed(old);
+    double noise = max(getSpread(old), getSpread(result));
+    return best < -(thresholds.speed + noise) && typical < -thresholds.speed;
+}
+
+int compare(const vector<Result> &baseline, const vector<Result> &results, const Thresholds &thresholds)
+{
+    int regressions = 0;
+    cout << fixed << setprecision(1);
+    for (const Result &result : results)
+    {
+        string name = result.name + (result.size >= 0 ? " " + to_string(result.size) : "");
+        const Result *old = findResult(baseline, result);
+        if (old == nullptr)
+        {
+            cout << left << setw(24) << name << "not in the baseline\n";
+            continue;
+        }
+
+        auto change = [](double before, double after)
+        { return before > 0 ? (after - before) / before : 0; };
+        double speed = change(getBestSpeed(*old), getBestSpeed(result));
+        double noise = max(getSpread(*old), getSpread(result));
+        double rss = change(old->peakRSS, result.peakRSS);
+        double nodes = change(old->nodes, result.nodes);
+        double bytes = change(old->bytes, result.bytes);
+
+        vector<string> regressed;
+        if (isSlower(*old, result, thresholds))
+            regressed.push_back("steps/s");
+        if (rss > thresholds.rss)
+            regressed.push_back("RSS");
+        if (nodes > thresholds.allocations || bytes > thresholds.allocations)
+            regressed.push_back("allocations");
+
+        cout << left << setw(24) << name << right << "steps/s " << showpos << setw(7) << speed * 100 << "% (noise "
+             << noshowpos << setw(4) << noise * 100 << "%)   RSS " << showpos << setw(7) << rss * 100 << "%   nodes "
+             << setw(7) << nodes * 100 << "%   bytes " << setw(7) << bytes * 100 << "%" << noshowpos;
+        if (*min_element(old->executes.begin(), old->executes.end()) < MIN_TIMED)
+            cout << "   too short to compare the speed";
+        if (result.steps != old->steps)
+            cout << "   steps " << old->steps << " -> " << result.steps;
+        for (size_t i = 0; i < regressed.size(); ++i)
+            cout << (i == 0 ? "   REGRESSED: " : ", ") << regressed[i];
+        cout << "\n";
+
+        regressions += !regressed.empty();
+    }
+
+    if (regressions > 0)
+        cout << regressions << " of " << results.size() << " benchmarks regressed\n";
+    else
+        cout << "No regressions in " << results.size() << " benchmarks\n";
+    return regressions;
+}
+
+double findNumber(const string &text, const string &key, const string &after)
+{
+    size_t position = text.find(key, after.empty() ? 0 : min(text.find(after), text.length()));
+    if (position == string::npos)
+        return -1;
+    return atof(text.c_str() + position + key.length());
+}
+
+vector<double> findNumbers(const string &text, const string &key)
+{
+    vector<double> numbers;
+    size_t position = text.find(key);
+    if (position == string::npos)
+        return numbers;
+
+    istringstream items(text.substr(position + key.length(), text.find(']', position) - position - key.length()));
+    for (string item; getline(items, item, ',');)
+        numbers.push_back(atof(item.c_str()));
+    return numbers;
+}
+
+double median(vector<double> numbers)
+{
+    sort(numbers.begin(), numbers.end());
+    size_t middle = numbers.size() / 2;
+    return numbers.size() % 2 == 1 ? numbers[middle] : (numbers[middle - 1] + numbers[middle]) / 2;
+}
+
+double getSpeed(const Result &result)
+{
+    double execute = median(result.executes);
+    return execute > 0 ? result.steps / execute : 0;
+}
+
+double getBestSpeed(const Result &result)
+{
+    double execute = *min_element(result.executes.begin(), result.executes.end());
+    return execute > 0 ? result.steps / execute : 0;
+}
+
+double getSpread(const Result &result)
+{
+    double fastest = *min_element(result.executes.begin(), result.executes.end());
+    double typical = median(result.executes);
+    return typical > 0 ? (typical - fastest) / typical : 0;
+}
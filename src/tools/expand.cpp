@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Print the state before a step the way the execution trace of -exe does
+ * @param control The control, from the bottom
+ * @param stack The stack, from the bottom
+ */
+void printStep(const vector<string> &control, const vector<string> &stack);
+
+int main(int argc, char *argv[])
+{
+    long from = 1;
+    long to = -1;
+    string filename = "exec.compact";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "-from" && i + 1 < argc)
+        {
+            from = stol(argv[++i]);
+        }
+        else if (arg == "-to" && i + 1 < argc)
+        {
+            to = stol(argv[++i]);
+        }
+        else if (arg[0] == '-')
+        {
+            cerr << "Usage: rpal-expand [-from step] [-to step] [trace_file]\n";
+            return 1;
+        }
+        else
+        {
+            filename = arg;
+        }
+    }
+
+    ifstream trace(filename);
+    if (!trace)
+    {
+        cerr << "File not found: " << filename << "\n";
+        return 1;
+    }
+
+    // Replay the trace, keeping the control and the stack as they are printed
+    vector<string> control;
+    vector<string> stack;
+    long step = 1;
+    bool started = false; // whether the state before the current step was handled
+    for (string line; getline(trace, line);)
+    {
+        if (line.length() < 2 || line[1] != ' ')
+        {
+            cerr << "Invalid trace line: " << line << "\n";
+            return 1;
+        }
+
+        char tag = line[0];
+        string item = line.substr(2);
+        if (tag == 'K')
+        {
+            // A snapshot replaces the state
+            size_t controlSize, stackSize;
+            if (sscanf(item.c_str(), "%ld %zu %zu", &step, &controlSize, &stackSize) != 3)
+            {
+                cerr << "Invalid trace line: " << line << "\n";
+                return 1;
+            }
+
+            control.clear();
+            stack.clear();
+            for (size_t i = 0; i < controlSize + stackSize && getline(trace, line); ++i)
+            {
+                (i < controlSize ? control : stack).push_back(line.substr(2));
+            }
+            started = false;
+            continue;
+        }
+
+        bool printed = step >= from && (to < 0 || step <= to);
+        if (!started)
+        {
+            if (control.empty())
+            {
+                cerr << "Invalid trace: step " << step << " starts with an empty control\n";
+                return 1;
+            }
+            if (printed)
+                printStep(control, stack);
+            control.pop_back();
+            started = true;
+        }
+
+        if (tag == 'x')
+        {
+            if (printed)
+                cout << item << "\n";
+        }
+        else if (tag == 'p')
+        {
+            stack.resize(stack.size() - min(stack.size(), (size_t)stol(item)));
+        }
+        else if (tag == 's')
+        {
+            stack.push_back(item);
+        }
+        else if (tag == 'c')
+        {
+            control.push_back(item);
+        }
+        else if (tag == 'r')
+        {
+            if (printed)
+                cout << setw(8) << "Rule"
+                     << ": " << item << "\n\n";
+            ++step;
+            started = false;
+        }
+        else
+        {
+            cerr << "Invalid trace line: " << line << "\n";
+            return 1;
+        }
+
+        if (to >= 0 && step > to)
+            break;
+    }
+
+    return 0;
+}
+
+void printStep(const vector<string> &control, const vector<string> &stack)
+{
+    cout << setw(8) << "Control"
+         << ": ";
+    for (int i = 0; i < (int)control.size(); ++i)
+    {
+        cout << control[i] << (i == (int)control.size() - 1 ? "\n" : " ");
+    }
+    cout << setw(8) << "Stack"
+         << ": ";
+    for (int i = stack.size() - 1; i >= 0; --i)
+    {
+        cout << stack[i] << (i == 0 ? "\n" : " ");
+    }
+    cout << setw(8) << "Next"
+         << ": " << control.back() << "\n";
+}
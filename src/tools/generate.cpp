@@ -0,0 +1,674 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Largest magnitude of an integer expression, so that no operation overflows
+static const long INT_LIMIT = 100000000;
+
+// Largest magnitude of the argument of a generated function
+static const long PARAMETER_LIMIT = 1000;
+
+// Most function calls an expression may make, counting the calls made by the called functions
+static const int MAX_COST = 64;
+
+// Categories of the operators and builtins, in the order of their weights
+enum Category
+{
+    ARITH,   // + - * / ** neg
+    COMPARE, // gr ls ge le eq ne
+    LOGIC,   // or & not
+    COND,    // ->
+    CALL,    // calls of the generated functions
+    STRING,  // Conc Stem Stern ItoS
+    TUPLE,   // tau aug Order and indexing
+    BUILTIN, // Isinteger Isstring Istuple Istruthvalue Null
+    CATEGORY_COUNT
+};
+
+static const char *CATEGORY_NAMES[] = {"arith", "compare", "logic", "cond", "call", "string", "tuple", "builtin"};
+
+enum Type
+{
+    INT,
+    BOOL,
+    STR,
+    TUPLE_OF_INTS,
+    TYPE_COUNT
+};
+
+// A node of the AST
+struct Node
+{
+    string label;
+    vector<Node> children;
+};
+
+// What is known about the value of an expression
+struct Info
+{
+    long bound = 0;        // largest magnitude of an integer, or of the elements of a tuple
+    int minLength = 0;     // shortest length of a string
+    int maxLength = 0;     // longest length of a string
+    int minSize = 0;       // smallest order of a tuple
+    int maxSize = 0;       // largest order of a tuple
+};
+
+// A generated expression
+struct Expression
+{
+    Node node;
+    Info info;
+    int cost = 0; // function calls made by evaluating it
+};
+
+// A name in scope
+struct Variable
+{
+    string name;
+    Type type;     // type of the value, or of the result of a function
+    bool function; // whether it is a function of an integer
+    Info info;     // what is known about the value, or about the result of a function
+    int cost;      // function calls made by calling the function, 0 for values
+};
+
+// The parameters of the generated program
+struct Parameters
+{
+    uint64_t seed = 1;
+    int depth = 4;          // depth of the generated expressions
+    int bindings = 20;      // let bindings before the driver
+    long recursion = 1000;  // iterations of the recursive driver
+    int tupleSize = 4;      // order of the generated tuples
+    int stringLength = 8;   // length of the generated string literals
+    int mix[CATEGORY_COUNT] = {3, 2, 1, 1, 2, 1, 1, 1};
+};
+
+/**
+ * Generates a random program that runs without errors: the expressions are typed, integers are kept small enough not to
+ * overflow, strings are only cut when they cannot be empty and tuples are only indexed within their order.
+ */
+class Generator
+{
+public:
+    /**
+     * @brief Create a generator
+     * @param parameters The parameters of the program
+     */
+    Generator(const Parameters &parameters) : parameters(parameters), random(parameters.seed)
+    {
+    }
+
+    /**
+     * @brief Generate a program: groups of simultaneous definitions of values and functions, each group in scope of the
+     *        next, and a recursive driver that counts the iterations in which a generated condition holds
+     * @return The root of the AST
+     */
+    Node generateProgram()
+    {
+        // Bindings of a group can only use the groups before it
+        vector<vector<pair<Node, Variable>>> groups;
+        for (int i = 0; i < parameters.bindings;)
+        {
+            int size = min(parameters.bindings - i, 1 + (int)pick(8));
+            vector<pair<Node, Variable>> group;
+            for (int j = 0; j < size; ++j, ++i)
+                group.push_back(generateBinding(i + 1));
+            for (const auto &binding : group)
+                scope.push_back(binding.second);
+            groups.push_back(group);
+        }
+
+        Node body = generateDriver();
+        for (int i = groups.size() - 1; i >= 0; --i)
+        {
+            Node definition;
+            if (groups[i].size() == 1)
+            {
+                definition = groups[i][0].first;
+            }
+            else
+            {
+                definition.label = "and";
+                for (const auto &binding : groups[i])
+                    definition.children.push_back(binding.first);
+            }
+            body = {"let", {definition, body}};
+        }
+        return body;
+    }
+
+private:
+    Parameters parameters;
+    mt19937_64 random;
+    vector<Variable> scope;
+
+    /**
+     * @brief Pick a random number
+     * @param n The number of choices
+     * @return A number from 0 to n - 1
+     */
+    uint64_t pick(uint64_t n)
+    {
+        return random() % n;
+    }
+
+    static Node leaf(const string &label)
+    {
+        return {label, {}};
+    }
+
+    static Node integer(long value)
+    {
+        return leaf("<INT:" + to_string(value) + ">");
+    }
+
+    static Node identifier(const string &name)
+    {
+        return leaf("<ID:" + name + ">");
+    }
+
+    static Node apply(const string &function, Node argument)
+    {
+        return {"gamma", {identifier(function), argument}};
+    }
+
+    /**
+     * @brief Generate a binding of a value or of a function of an integer
+     * @param number The number of the binding, used in its name
+     * @return The definition and the name it binds
+     */
+    pair<Node, Variable> generateBinding(int number)
+    {
+        if (parameters.mix[CALL] > 0 && pick(2) == 0)
+        {
+            // The parameter is only in scope in the body
+            string name = "f" + to_string(number);
+            scope.push_back({"x", INT, false, Info{PARAMETER_LIMIT}, 0});
+            Expression body = generate(INT, parameters.depth, INT_LIMIT);
+            scope.pop_back();
+
+            Node definition = {"function_form", {identifier(name), identifier("x"), body.node}};
+            return {definition, {name, INT, true, body.info, body.cost + 1}};
+        }
+
+        string name = "v" + to_string(number);
+        Type type = (Type)pick(TYPE_COUNT);
+        Expression value = generate(type, parameters.depth, type == STR ? 4 * parameters.stringLength : INT_LIMIT);
+        return {{"=", {identifier(name), value.node}}, {name, type, false, value.info, 0}};
+    }
+
+    /**
+     * @brief Generate the driver: rec Loop n acc = n eq 0 -> acc | Loop (n - 1) (acc + (condition -> 1 | 0)), applied to
+     *        the number of iterations
+     * @return The expression printing the result of the driver
+     */
+    Node generateDriver()
+    {
+        scope.push_back({"n", INT, false, Info{max(parameters.recursion, 1L)}, 0});
+        Expression condition = generate(BOOL, parameters.depth, INT_LIMIT);
+        scope.pop_back();
+
+        Node step = {"->", {condition.node, integer(1), integer(0)}};
+        Node next = {"gamma", {{"gamma", {identifier("Loop"), {"-", {identifier("n"), integer(1)}}}}, {"+", {identifier("acc"), step}}}};
+        Node loop = {"function_form",
+                     {identifier("Loop"), identifier("n"), identifier("acc"),
+                      {"->", {{"eq", {identifier("n"), integer(0)}}, identifier("acc"), next}}}};
+        Node run = {"gamma", {{"gamma", {identifier("Loop"), integer(parameters.recursion)}}, integer(0)}};
+        return {"let", {{"rec", {loop}}, apply("Print", run)}};
+    }
+
+    /**
+     * @brief Generate an expression
+     * @param type The type of the value
+     * @param depth The depth left for the expression
+     * @param limit The largest magnitude of an integer or of the elements of a tuple, or the longest length of a string
+     * @return The expression
+     */
+    Expression generate(Type type, int depth, long limit)
+    {
+        if (depth > 0 && pick(5) != 0)
+        {
+            // Choose among the productions of the type by the weight of their category
+            vector<pair<int, function<bool(Expression &)>>> productions = getProductions(type, depth, limit);
+            int total = 0;
+            for (const auto &production : productions)
+                total += production.first;
+            if (total > 0)
+            {
+                int choice = pick(total);
+                for (const auto &production : productions)
+                {
+                    choice -= production.first;
+                    Expression expression;
+                    if (choice < 0)
+                    {
+                        if (production.second(expression) && expression.cost <= MAX_COST)
+                            return expression;
+                        break;
+                    }
+                }
+            }
+        }
+        return generateLeaf(type, limit);
+    }
+
+    /**
+     * @brief Get the ways to build an expression of a type
+     * @param type The type of the value
+     * @param depth The depth left for the expression
+     * @param limit As for generate
+     * @return The weight of each production and a function building it, which fails if it cannot keep to the limit
+     */
+    vector<pair<int, function<bool(Expression &)>>> getProductions(Type type, int depth, long limit)
+    {
+        const int *mix = parameters.mix;
+        vector<pair<int, function<bool(Expression &)>>> productions;
+        auto add = [&](Category category, function<bool(Expression &)> production)
+        { productions.push_back({mix[category], production}); };
+
+        add(COND, [=](Expression &result)
+            {
+                Expression condition = generate(BOOL, depth - 1, INT_LIMIT);
+                Expression a = generate(type, depth - 1, limit);
+                Expression b = generate(type, depth - 1, limit);
+                result.node = {"->", {condition.node, a.node, b.node}};
+                result.info.bound = max(a.info.bound, b.info.bound);
+                result.info.minLength = min(a.info.minLength, b.info.minLength);
+                result.info.maxLength = max(a.info.maxLength, b.info.maxLength);
+                result.info.minSize = min(a.info.minSize, b.info.minSize);
+                result.info.maxSize = max(a.info.maxSize, b.info.maxSize);
+                result.cost = condition.cost + max(a.cost, b.cost);
+                return true; });
+
+        if (type == INT)
+        {
+            for (string op : {"+", "-"})
+            {
+                add(ARITH, [=](Expression &result)
+                    { return binary(result, op, INT, depth, limit / 2, limit / 2, [](long a, long b)
+                                    { return a + b; }); });
+            }
+            add(ARITH, [=](Expression &result)
+                {
+                    long root = (long)sqrt((double)limit);
+                    return binary(result, "*", INT, depth, root, root, [](long a, long b)
+                                  { return a * b; }); });
+            add(ARITH, [=](Expression &result)
+                {
+                    Expression a = generate(INT, depth - 1, limit);
+                    result.node = {"/", {a.node, integer(1 + pick(9))}};
+                    result.info.bound = a.info.bound;
+                    result.cost = a.cost;
+                    return true; });
+            add(ARITH, [=](Expression &result)
+                {
+                    Expression a = generate(INT, depth - 1, limit);
+                    result.node = {"neg", {a.node}};
+                    result.info.bound = a.info.bound;
+                    result.cost = a.cost;
+                    return true; });
+            add(ARITH, [=](Expression &result)
+                {
+                    if (limit < 729)
+                        return false;
+                    long base = pick(10), exponent = pick(4);
+                    result.node = {"**", {integer(base), integer(exponent)}};
+                    result.info.bound = (long)pow(base, exponent);
+                    return true; });
+            add(CALL, [=](Expression &result)
+                {
+                    vector<const Variable *> functions;
+                    for (const Variable &variable : scope)
+                    {
+                        if (variable.function && variable.info.bound <= limit && variable.cost <= MAX_COST / 4)
+                            functions.push_back(&variable);
+                    }
+                    if (functions.empty())
+                        return false;
+                    const Variable &function = *functions[pick(functions.size())];
+                    Expression argument = generate(INT, depth - 1, PARAMETER_LIMIT);
+                    result.node = apply(function.name, argument.node);
+                    result.info.bound = function.info.bound;
+                    result.cost = argument.cost + function.cost;
+                    return true; });
+            add(TUPLE, [=](Expression &result)
+                {
+                    Expression tuple = generate(TUPLE_OF_INTS, depth - 1, INT_LIMIT);
+                    if (tuple.info.maxSize > limit)
+                        return false;
+                    result.node = apply("Order", tuple.node);
+                    result.info.bound = tuple.info.maxSize;
+                    result.cost = tuple.cost;
+                    return true; });
+            add(TUPLE, [=](Expression &result)
+                {
+                    Expression tuple = generate(TUPLE_OF_INTS, depth - 1, limit);
+                    if (tuple.info.minSize < 1)
+                        return false;
+                    result.node = {"gamma", {tuple.node, integer(1 + pick(tuple.info.minSize))}};
+                    result.info.bound = tuple.info.bound;
+                    result.cost = tuple.cost;
+                    return true; });
+        }
+        else if (type == BOOL)
+        {
+            for (string op : {"gr", "ls", "ge", "le", "eq", "ne"})
+            {
+                add(COMPARE, [=](Expression &result)
+                    { return binary(result, op, INT, depth, INT_LIMIT, INT_LIMIT, nullptr); });
+            }
+            for (string op : {"eq", "ne"})
+            {
+                add(COMPARE, [=](Expression &result)
+                    { return binary(result, op, STR, depth, 4 * parameters.stringLength, 4 * parameters.stringLength, nullptr); });
+            }
+            for (string op : {"or", "&"})
+            {
+                add(LOGIC, [=](Expression &result)
+                    { return binary(result, op, BOOL, depth, 0, 0, nullptr); });
+            }
+            add(LOGIC, [=](Expression &result)
+                {
+                    Expression a = generate(BOOL, depth - 1, 0);
+                    result.node = {"not", {a.node}};
+                    result.cost = a.cost;
+                    return true; });
+            for (string function : {"Isinteger", "Isstring", "Istuple", "Istruthvalue"})
+            {
+                add(BUILTIN, [=](Expression &result)
+                    {
+                        Type argumentType = (Type)pick(TYPE_COUNT);
+                        Expression a = generate(argumentType, depth - 1, argumentType == STR ? 4 * parameters.stringLength : INT_LIMIT);
+                        result.node = apply(function, a.node);
+                        result.cost = a.cost;
+                        return true; });
+            }
+            add(BUILTIN, [=](Expression &result)
+                {
+                    Expression a = generate(TUPLE_OF_INTS, depth - 1, INT_LIMIT);
+                    result.node = apply("Null", a.node);
+                    result.cost = a.cost;
+                    return true; });
+        }
+        else if (type == STR)
+        {
+            add(STRING, [=](Expression &result)
+                {
+                    if (limit < 2)
+                        return false;
+                    Expression a = generate(STR, depth - 1, limit / 2);
+                    Expression b = generate(STR, depth - 1, limit / 2);
+                    result.node = {"gamma", {apply("Conc", a.node), b.node}};
+                    result.info.minLength = a.info.minLength + b.info.minLength;
+                    result.info.maxLength = a.info.maxLength + b.info.maxLength;
+                    result.cost = a.cost + b.cost;
+                    return true; });
+            add(STRING, [=](Expression &result)
+                {
+                    Expression a = generate(STR, depth - 1, limit + 1);
+                    if (a.info.minLength < 1)
+                        return false;
+                    result.node = apply("Stern", a.node);
+                    result.info.minLength = a.info.minLength - 1;
+                    result.info.maxLength = a.info.maxLength - 1;
+                    result.cost = a.cost;
+                    return true; });
+            add(STRING, [=](Expression &result)
+                {
+                    Expression a = generate(STR, depth - 1, 4 * parameters.stringLength);
+                    if (a.info.minLength < 1 || limit < 1)
+                        return false;
+                    result.node = apply("Stem", a.node);
+                    result.info.minLength = result.info.maxLength = 1;
+                    result.cost = a.cost;
+                    return true; });
+            add(STRING, [=](Expression &result)
+                {
+                    // An integer of at most INT_LIMIT has at most 9 digits and a sign
+                    if (limit < 10)
+                        return false;
+                    Expression a = generate(INT, depth - 1, INT_LIMIT);
+                    result.node = apply("ItoS", a.node);
+                    result.info.minLength = 1;
+                    result.info.maxLength = 10;
+                    result.cost = a.cost;
+                    return true; });
+        }
+        else
+        {
+            add(TUPLE, [=](Expression &result)
+                {
+                    result = generateTuple(depth, limit);
+                    return true; });
+            add(TUPLE, [=](Expression &result)
+                {
+                    // aug extends the tuple it is given, so it only gets tuples that are not bound to a name
+                    Expression tuple = generateTuple(depth, limit);
+                    Expression a = generate(INT, depth - 1, limit);
+                    result.node = {"aug", {tuple.node, a.node}};
+                    result.info = tuple.info;
+                    result.info.bound = max(tuple.info.bound, a.info.bound);
+                    result.info.minSize++;
+                    result.info.maxSize++;
+                    result.cost = tuple.cost + a.cost;
+                    return true; });
+        }
+        return productions;
+    }
+
+    /**
+     * @brief Build an application of a binary operator
+     * @param result Set to the application
+     * @param op The operator
+     * @param type The type of the operands
+     * @param depth The depth left for the application
+     * @param leftLimit The limit of the left operand
+     * @param rightLimit The limit of the right operand
+     * @param bound Gets the bound of the result from the bounds of the operands, nullptr if the result is not an integer
+     * @return true
+     */
+    bool binary(Expression &result, const string &op, Type type, int depth, long leftLimit, long rightLimit,
+                function<long(long, long)> bound)
+    {
+        Expression a = generate(type, depth - 1, leftLimit);
+        Expression b = generate(type, depth - 1, rightLimit);
+        result.node = {op, {a.node, b.node}};
+        if (bound != nullptr)
+            result.info.bound = bound(a.info.bound, b.info.bound);
+        result.cost = a.cost + b.cost;
+        return true;
+    }
+
+    /**
+     * @brief Generate a tuple expression of the configured order
+     * @param depth The depth left for the expression
+     * @param limit The largest magnitude of an element
+     * @return The tuple
+     */
+    Expression generateTuple(int depth, long limit)
+    {
+        Expression result;
+        result.node.label = "tau";
+        int size = max(2, parameters.tupleSize);
+        for (int i = 0; i < size; ++i)
+        {
+            Expression element = generate(INT, depth - 1, limit);
+            result.node.children.push_back(element.node);
+            result.info.bound = max(result.info.bound, element.info.bound);
+            result.cost += element.cost;
+        }
+        result.info.minSize = result.info.maxSize = size;
+        return result;
+    }
+
+    /**
+     * @brief Generate a literal or a name in scope
+     * @param type The type of the value
+     * @param limit As for generate
+     * @return The expression
+     */
+    Expression generateLeaf(Type type, long limit)
+    {
+        vector<const Variable *> variables;
+        for (const Variable &variable : scope)
+        {
+            if (!variable.function && variable.type == type && (type != STR || variable.info.maxLength <= limit))
+                variables.push_back(&variable);
+        }
+
+        Expression result;
+        if (!variables.empty() && pick(2) == 0)
+        {
+            // Favour the innermost name, so the parameters of the functions and of the driver get used
+            const Variable &variable = pick(2) == 0 ? *variables.back() : *variables[pick(variables.size())];
+            result.node = identifier(variable.name);
+            result.info = variable.info;
+            if ((type == INT || type == TUPLE_OF_INTS) && variable.info.bound > limit)
+            {
+                // Scale an integer down to the limit; a tuple with larger elements cannot be used
+                if (type == TUPLE_OF_INTS)
+                    return generateTuple(0, limit);
+                long divisor = (variable.info.bound + limit - 1) / max(limit, 1L);
+                result.node = {"/", {result.node, integer(divisor)}};
+                result.info.bound = variable.info.bound / divisor;
+            }
+            return result;
+        }
+
+        if (type == INT)
+        {
+            result.info.bound = pick(min(99L, limit) + 1);
+            result.node = integer(result.info.bound);
+        }
+        else if (type == BOOL)
+        {
+            result.node = leaf(pick(2) == 0 ? "<true>" : "<false>");
+        }
+        else if (type == STR)
+        {
+            int length = pick(min((long)parameters.stringLength, limit) + 1);
+            string value;
+            for (int i = 0; i < length; ++i)
+                value += (char)('a' + pick(26));
+            result.node = leaf("<STR:'" + value + "'>");
+            result.info.minLength = result.info.maxLength = length;
+        }
+        else
+        {
+            result = generateTuple(0, limit);
+        }
+        return result;
+    }
+};
+
+/**
+ * @brief Write an AST in the dotted format
+ * @param node The root of the AST
+ * @param level The depth of the root
+ * @param os The output stream to write to
+ */
+void writeTree(const Node &node, int level, ostream &os);
+
+/**
+ * @brief Parse the weights of the categories
+ * @param str A comma separated list of category=weight; categories left out keep their weight
+ * @param mix The weights to change
+ * @return true if the list is valid, false otherwise
+ */
+bool parseMix(const string &str, int mix[]);
+
+int main(int argc, char *argv[])
+{
+    Parameters parameters;
+    string outputFile;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool valid = true;
+        if (arg == "-seed" && i + 1 < argc)
+            parameters.seed = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "-depth" && i + 1 < argc)
+            valid = (parameters.depth = atoi(argv[++i])) >= 0;
+        else if (arg == "-bindings" && i + 1 < argc)
+            valid = (parameters.bindings = atoi(argv[++i])) >= 0;
+        else if (arg == "-recursion" && i + 1 < argc)
+            valid = (parameters.recursion = atol(argv[++i])) >= 0;
+        else if (arg == "-tuple" && i + 1 < argc)
+            valid = (parameters.tupleSize = atoi(argv[++i])) >= 2;
+        else if (arg == "-string" && i + 1 < argc)
+            valid = (parameters.stringLength = atoi(argv[++i])) >= 1;
+        else if (arg == "-mix" && i + 1 < argc)
+            valid = parseMix(argv[++i], parameters.mix);
+        else if (arg == "-o" && i + 1 < argc)
+            outputFile = argv[++i];
+        else
+        {
+            cerr << "Usage: rpal-generate [-seed n] [-depth n] [-bindings n] [-recursion n] [-tuple n] [-string n]\n"
+                 << "                     [-mix category=weight,...] [-o file]\n";
+            return 1;
+        }
+
+        if (!valid)
+        {
+            cerr << "Invalid value: " << arg << " " << argv[i] << "\n";
+            return 1;
+        }
+    }
+
+    Generator generator(parameters);
+    Node program = generator.generateProgram();
+    if (outputFile.empty())
+    {
+        writeTree(program, 0, cout);
+    }
+    else
+    {
+        ofstream output(outputFile);
+        writeTree(program, 0, output);
+        if (!output)
+        {
+            cerr << "Error: Could not write " << outputFile << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void writeTree(const Node &node, int level, ostream &os)
+{
+    os << string(level, '.') << node.label << "\n";
+    for (const Node &child : node.children)
+        writeTree(child, level + 1, os);
+}
+
+bool parseMix(const string &str, int mix[])
+{
+    stringstream ss(str);
+    for (string item; getline(ss, item, ',');)
+    {
+        size_t equals = item.find('=');
+        if (equals == string::npos)
+            return false;
+        string name = item.substr(0, equals);
+        auto category = find(begin(CATEGORY_NAMES), end(CATEGORY_NAMES), name);
+        if (category == end(CATEGORY_NAMES))
+            return false;
+        char *end;
+        long weight = strtol(item.c_str() + equals + 1, &end, 10);
+        if (*end != '\0' || end == item.c_str() + equals + 1 || weight < 0)
+            return false;
+        mix[category - begin(CATEGORY_NAMES)] = weight;
+    }
+    return true;
+}
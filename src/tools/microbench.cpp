@@ -0,0 +1,320 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../allocation.h"
+#include "../ast.h"
+#include "../environment.h"
+#include "../source.h"
+#include "../st.h"
+
+using namespace std;
+
+// Defined in cse_machine.cpp
+shared_ptr<STNode> apply(shared_ptr<BinaryOperator> binOp, shared_ptr<STNode> rand_l, shared_ptr<STNode> rand_r);
+
+// Name of the file the synthetic programs are written to
+static const string INPUT_FILE = "microbench_input";
+
+// The timings of a benchmark; the times are per repetition of the operation
+struct Result
+{
+    string name;
+    long iterations; // repetitions of the operation over all the samples
+    long samples;
+    double median; // in nanoseconds
+    double p99;    // in nanoseconds
+};
+
+/**
+ * Times operations in samples. Fast operations are repeated within a sample so that a sample takes long enough for the
+ * clock; samples are taken until the time budget is spent and there are enough of them for the 99th percentile.
+ */
+class Harness
+{
+public:
+    /**
+     * @brief Create a harness
+     * @param budget The time to spend on each benchmark in seconds
+     * @param filter Only the benchmarks whose names contain it are run
+     */
+    Harness(double budget, string filter) : budget(budget * 1e9), filter(filter)
+    {
+    }
+
+    /**
+     * @brief Time an operation
+     * @param name The name of the benchmark
+     * @param operation The operation
+     */
+    void measure(const string &name, const function<void()> &operation)
+    {
+        if (name.find(filter) == string::npos)
+            return;
+
+        // Find how many repetitions make a sample
+        long repetitions = 1;
+        while (time(operation, repetitions) < budget / TARGET_SAMPLES && repetitions < (1L << 30))
+            repetitions *= 2;
+
+        vector<double> samples;
+        double spent = 0;
+        while ((spent < budget || samples.size() < MIN_SAMPLES) && samples.size() < MAX_SAMPLES)
+        {
+            double sample = time(operation, repetitions);
+            spent += sample;
+            samples.push_back(sample / repetitions);
+        }
+        add(name, samples, repetitions);
+    }
+
+    /**
+     * @brief Time an operation that needs a fresh input each time; the input is prepared outside the timing
+     * @param name The name of the benchmark
+     * @param setup Prepares the input of the next repetition
+     * @param operation The operation
+     */
+    void measure(const string &name, const function<void()> &setup, const function<void()> &operation)
+    {
+        if (name.find(filter) == string::npos)
+            return;
+
+        vector<double> samples;
+        double spent = 0;
+        while ((spent < budget || samples.size() < MIN_SAMPLES) && samples.size() < MAX_SAMPLES)
+        {
+            setup();
+            double sample = time(operation, 1);
+            spent += sample;
+            samples.push_back(sample);
+        }
+        add(name, samples, 1);
+    }
+
+    /**
+     * @brief Print the results
+     * @param os The output stream to print to
+     * @param json Whether to print JSON instead of a table
+     */
+    void print(ostream &os, bool json) const
+    {
+        os << fixed << setprecision(1);
+        if (json)
+        {
+            os << "{\"benchmarks\": [";
+            for (size_t i = 0; i < results.size(); ++i)
+            {
+                const Result &result = results[i];
+                os << (i == 0 ? "" : ",") << "\n  {\"name\": \"" << result.name << "\", \"iterations\": " << result.iterations
+                   << ", \"samples\": " << result.samples << ", \"median_ns\": " << result.median << ", \"p99_ns\": " << result.p99
+                   << "}";
+            }
+            os << "\n]}\n";
+            return;
+        }
+
+        os << left << setw(40) << "Benchmark" << right << setw(14) << "Iterations" << setw(14) << "Median ns" << setw(14)
+           << "p99 ns"
+           << "\n";
+        for (const Result &result : results)
+        {
+            os << left << setw(40) << result.name << right << setw(14) << result.iterations << setw(14) << result.median
+               << setw(14) << result.p99 << "\n";
+        }
+    }
+
+private:
+    static const size_t MIN_SAMPLES = 200;
+    static const size_t MAX_SAMPLES = 1000000;
+    static constexpr double TARGET_SAMPLES = 400; // samples the budget is meant to be spread over
+
+    double budget; // in nanoseconds
+    string filter;
+    vector<Result> results;
+
+    /**
+     * @brief Time repetitions of an operation
+     * @param operation The operation
+     * @param repetitions The number of repetitions
+     * @return The time taken in nanoseconds
+     */
+    static double time(const function<void()> &operation, long repetitions)
+    {
+        auto start = chrono::steady_clock::now();
+        for (long i = 0; i < repetitions; ++i)
+            operation();
+        return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    }
+
+    /**
+     * @brief Record the result of a benchmark
+     * @param name The name of the benchmark
+     * @param samples The time per repetition in each sample, in nanoseconds
+     * @param repetitions The repetitions in a sample
+     */
+    void add(const string &name, vector<double> &samples, long repetitions)
+    {
+        sort(samples.begin(), samples.end());
+        size_t count = samples.size();
+        double median = count % 2 == 1 ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2;
+        double p99 = samples[(size_t)ceil(0.99 * count) - 1];
+        results.push_back({name, (long)count * repetitions, (long)count, median, p99});
+    }
+};
+
+/**
+ * @brief Write a synthetic program: one function per binding of a simultaneous definition, each with a conditional,
+ *        and a call of the first one
+ * @param functions The number of functions
+ * @return The number of lines of the AST
+ */
+long writeProgram(int functions);
+
+int main(int argc, char *argv[])
+{
+    double budget = 0.2;
+    string filter;
+    bool json = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "-time" && i + 1 < argc)
+        {
+            budget = atof(argv[++i]);
+            if (budget <= 0)
+            {
+                cerr << "Invalid time: " << argv[i] << "\n";
+                return 1;
+            }
+        }
+        else if (arg == "-json")
+        {
+            json = true;
+        }
+        else if (arg[0] == '-')
+        {
+            cerr << "Usage: rpal-microbench [-time seconds] [-json] [filter]\n";
+            return 1;
+        }
+        else
+        {
+            filter = arg;
+        }
+    }
+
+    Harness harness(budget, filter);
+
+    // Look up a name bound at the bottom of a chain of environments, and a built-in bound in the primitive environment
+    shared_ptr<Environment> primitive = makeNode<Environment>();
+    for (int depth : {1, 4, 16, 64})
+    {
+        shared_ptr<Environment> env = makeNode<Environment>();
+        env->setParent(primitive);
+        env->addVariable("x", makeNode<Integer>(1));
+        for (int i = 1; i < depth; ++i)
+        {
+            shared_ptr<Environment> child = makeNode<Environment>();
+            child->setParent(env);
+            child->addVariable("y" + to_string(i), makeNode<Integer>(i));
+            env = child;
+        }
+
+        harness.measure("lookup/depth=" + to_string(depth), [&]()
+                        { lookup("x", env); });
+        harness.measure("lookup/Print/depth=" + to_string(depth), [&]()
+                        { lookup("Print", env); });
+    }
+
+    // Apply each binary operator to each pair of types it is defined for
+    struct Operands
+    {
+        string types;
+        shared_ptr<STNode> left, right;
+    };
+    Operands integers = {"Integer,Integer", makeNode<Integer>(12), makeNode<Integer>(3)};
+    Operands truths = {"TruthValue,TruthValue", makeNode<TruthValue>(true), makeNode<TruthValue>(false)};
+    Operands strings = {"String,String", makeNode<String>("abcdef"), makeNode<String>("abcxyz")};
+    vector<pair<string, vector<Operands>>> operations = {
+        {"+", {integers}}, {"-", {integers}}, {"*", {integers}}, {"/", {integers}}, {"**", {integers}},
+        {"or", {truths}}, {"&", {truths}}, {"gr", {integers, strings}}, {"ls", {integers, strings}},
+        {"ge", {integers, strings}}, {"le", {integers, strings}}, {"eq", {integers, truths, strings}},
+        {"ne", {integers, truths, strings}}};
+    for (const auto &operation : operations)
+    {
+        shared_ptr<BinaryOperator> binOp = makeNode<BinaryOperator>(operation.first);
+        for (const Operands &operands : operation.second)
+        {
+            harness.measure("apply/" + operation.first + "/" + operands.types, [&]()
+                            { apply(binOp, operands.left, operands.right); });
+        }
+    }
+
+    // aug extends its tuple in place, so it gets a new empty tuple each time
+    shared_ptr<BinaryOperator> aug = makeNode<BinaryOperator>("aug");
+    harness.measure("apply/aug/Tuple,Integer (new tuple)", [&]()
+                    { apply(aug, makeNode<Tuple>(), integers.right); });
+
+    for (int size : {1, 10, 100, 1000})
+    {
+        vector<shared_ptr<STNode>> values;
+        for (int i = 0; i < size; ++i)
+            values.push_back(makeNode<Integer>(i));
+        shared_ptr<Tuple> tuple = makeNode<Tuple>(values);
+
+        harness.measure("Tuple::getCopy/size=" + to_string(size), [&]()
+                        { tuple->getCopy(); });
+    }
+
+    // Build the AST of synthetic programs, and generate their control structures from the standardized tree
+    for (int functions : {10, 100, 300})
+    {
+        long lines = writeProgram(functions);
+        string suffix = "/nodes=" + to_string(lines);
+
+        unique_ptr<SourceFile> source;
+        unique_ptr<TextASTReader> reader;
+        auto open = [&]()
+        {
+            reader.reset();
+            source = make_unique<SourceFile>(INPUT_FILE);
+            reader = make_unique<TextASTReader>(*source);
+        };
+        harness.measure("AST::createAST" + suffix, open, [&]()
+                        { AST::createAST(*reader); });
+
+        shared_ptr<ST> st;
+        auto standardize = [&]()
+        {
+            open();
+            st = AST::streamStandardize(*reader);
+        };
+        harness.measure("ST::compile" + suffix, standardize, [&]()
+                        { st->compile(); });
+    }
+    remove(INPUT_FILE.c_str());
+
+    harness.print(cout, json);
+    return 0;
+}
+
+long writeProgram(int functions)
+{
+    ofstream out(INPUT_FILE);
+    out << "let\n.and\n";
+    for (int i = 0; i < functions; ++i)
+    {
+        out << "..function_form\n...<ID:f" << i << ">\n...<ID:x>\n...->\n....eq\n.....<ID:x>\n.....<INT:" << i
+            << ">\n....+\n.....<ID:x>\n.....<INT:1>\n....-\n.....<ID:x>\n.....<INT:1>\n";
+    }
+    out << ".gamma\n..<ID:Print>\n..gamma\n...<ID:f0>\n...<INT:0>\n";
+    return 2 + 13L * functions + 5;
+}
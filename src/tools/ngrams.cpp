@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Split the element printed on a 'Next' line of an execution trace into control structure elements
+ * @param str The text after "Next: "
+ * @return The elements in the order they were executed
+ */
+vector<string> splitElements(const string &str);
+
+/**
+ * @brief Get the kind of a control structure element from its printed form
+ * @param element The printed element
+ * @param keepOperators Whether to keep the name of operators instead of their kind
+ * @return The kind of the element
+ */
+string getKind(const string &element, bool keepOperators);
+
+int main(int argc, char *argv[])
+{
+    int maxN = 3;
+    int top = 20;
+    bool keepOperators = false;
+    string filename = "exec.txt";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc)
+        {
+            maxN = stoi(argv[++i]);
+        }
+        else if (arg == "-top" && i + 1 < argc)
+        {
+            top = stoi(argv[++i]);
+        }
+        else if (arg == "-ops")
+        {
+            keepOperators = true;
+        }
+        else if (arg[0] == '-')
+        {
+            cerr << "Usage: rpal-ngrams [-n max_length] [-top count] [-ops] [trace_file]\n";
+            return 1;
+        }
+        else
+        {
+            filename = arg;
+        }
+    }
+
+    ifstream trace(filename);
+    if (!trace)
+    {
+        cerr << "File not found: " << filename << "\n";
+        return 1;
+    }
+
+    // Collect the executed elements in order from the 'Next' lines of the trace
+    vector<string> kinds;
+    const string prefix = "Next: ";
+    for (string line; getline(trace, line);)
+    {
+        size_t start = line.find_first_not_of(' ');
+        if (start == string::npos || line.compare(start, prefix.length(), prefix) != 0)
+            continue;
+
+        for (string element : splitElements(line.substr(start + prefix.length())))
+            kinds.push_back(getKind(element, keepOperators));
+    }
+
+    cout << kinds.size() << " executed elements\n";
+
+    for (int n = 2; n <= maxN; ++n)
+    {
+        if ((int)kinds.size() < n)
+            break;
+
+        map<vector<string>, long long> counts;
+        for (int i = 0; i + n <= (int)kinds.size(); ++i)
+        {
+            // Environment markers are placed by the machine and cannot be fused
+            vector<string> gram(kinds.begin() + i, kinds.begin() + i + n);
+            if (find(gram.begin(), gram.end(), "Environment") != gram.end())
+                continue;
+            ++counts[gram];
+        }
+
+        vector<pair<long long, vector<string>>> sorted;
+        for (auto &entry : counts)
+            sorted.push_back({entry.second, entry.first});
+        sort(sorted.begin(), sorted.end(), [](const pair<long long, vector<string>> &a, const pair<long long, vector<string>> &b)
+             { return a.first != b.first ? a.first > b.first : a.second < b.second; });
+
+        long long total = kinds.size() - n + 1;
+        cout << "\n"
+             << n << "-grams:\n";
+        for (int i = 0; i < (int)sorted.size() && i < top; ++i)
+        {
+            cout << setw(12) << sorted[i].first << " " << setw(6) << fixed << setprecision(2) << 100.0 * sorted[i].first / total << "%  ";
+            for (int j = 0; j < n; ++j)
+                cout << sorted[i].second[j] << (j == n - 1 ? "\n" : " ");
+        }
+    }
+
+    return 0;
+}
+
+vector<string> splitElements(const string &str)
+{
+    // Superinstructions print all of their fused elements in control structure order
+    vector<string> elements;
+    size_t i = 0;
+    while (i < str.length())
+    {
+        if (str[i] == ' ')
+        {
+            ++i;
+            continue;
+        }
+
+        size_t end;
+        if (str[i] == '\'')
+        {
+            end = str.find('\'', i + 1);
+            end = end == string::npos ? str.length() : end + 1;
+        }
+        else
+        {
+            end = str.find(' ', i);
+            end = end == string::npos ? str.length() : end;
+        }
+
+        string element = str.substr(i, end - i);
+        if (element == "beta" && elements.size() >= 2 && elements[elements.size() - 1].rfind("delta_", 0) == 0)
+        {
+            // "delta_i delta_j beta" is a single branch
+            elements.pop_back();
+            elements.pop_back();
+        }
+        elements.push_back(element);
+        i = end;
+    }
+
+    // The control structure is executed from the back
+    reverse(elements.begin(), elements.end());
+    return elements;
+}
+
+string getKind(const string &element, bool keepOperators)
+{
+    static const vector<string> unOps = {"not", "neg"};
+    static const vector<string> binOps = {"+", "-", "*", "/", "**", "aug", "or", "&", "gr", "ls", "ge", "le", "eq", "ne"};
+
+    if (find(binOps.begin(), binOps.end(), element) != binOps.end())
+        return keepOperators ? element : "BinaryOperator";
+    if (find(unOps.begin(), unOps.end(), element) != unOps.end())
+        return keepOperators ? element : "UnaryOperator";
+    if (element[0] == '\'')
+        return "String";
+    if (isdigit(element[0]) || (element[0] == '-' && element.length() > 1))
+        return "Integer";
+    if (element == "gamma")
+        return "Gamma";
+    if (element == "beta")
+        return "Beta";
+    if (element == "true" || element == "false")
+        return "TruthValue";
+    if (element == "nil")
+        return "Tuple";
+    if (element == "dummy")
+        return "Dummy";
+    if (element == "Y")
+        return "YStar";
+    if (element.rfind("tau_", 0) == 0)
+        return "Tau";
+    if (element.find("lambda") != string::npos)
+        return "Lambda";
+    if (element.rfind("e_", 0) == 0 && element.length() > 2 && isdigit(element[2]))
+        return "Environment";
+    return "Identifier";
+}
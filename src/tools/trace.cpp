@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../trace_format.h"
+
+using namespace std;
+
+/**
+ * @brief Parse a comma separated list of numbers
+ * @param str The list
+ * @param numbers Set to the numbers in the list
+ * @return true if the list is valid, false otherwise
+ */
+bool parseList(const string &str, set<long> &numbers);
+
+/**
+ * @brief Print the counts of a summary table, the most frequent first
+ * @param title The title of the table
+ * @param counts The counts, keyed by the printed name
+ * @param total The number of steps counted
+ */
+void printCounts(const string &title, const map<string, long> &counts, long total);
+
+int main(int argc, char *argv[])
+{
+    set<long> rules;
+    set<long> deltas;
+    bool summary = false;
+    string filename = "exec.bin";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "-rule" && i + 1 < argc)
+        {
+            if (!parseList(argv[++i], rules))
+            {
+                cerr << "Invalid rule list: " << argv[i] << "\n";
+                return 1;
+            }
+        }
+        else if (arg == "-delta" && i + 1 < argc)
+        {
+            if (!parseList(argv[++i], deltas))
+            {
+                cerr << "Invalid delta list: " << argv[i] << "\n";
+                return 1;
+            }
+        }
+        else if (arg == "-summary")
+        {
+            summary = true;
+        }
+        else if (arg[0] == '-')
+        {
+            cerr << "Usage: rpal-trace [-rule list] [-delta list] [-summary] [trace_file]\n";
+            return 1;
+        }
+        else
+        {
+            filename = arg;
+        }
+    }
+
+    ifstream trace(filename, ios::binary);
+    if (!trace)
+    {
+        cerr << "File not found: " << filename << "\n";
+        return 1;
+    }
+
+    char header[sizeof(TRACE_HEADER)];
+    if (!trace.read(header, sizeof(header)) || memcmp(header, TRACE_HEADER, sizeof(header)) != 0)
+    {
+        cerr << "Not a binary trace: " << filename << "\n";
+        return 1;
+    }
+
+    const int opcodeCount = sizeof(OPCODE_NAMES) / sizeof(OPCODE_NAMES[0]);
+    long steps = 0;
+    long matched = 0;
+    uint32_t maxDepth = 0;
+    map<string, long> ruleCounts, opcodeCounts, deltaCounts;
+
+    TraceRecord record;
+    while (trace.read(reinterpret_cast<char *>(&record), sizeof(record)))
+    {
+        ++steps;
+        if ((!rules.empty() && rules.count(record.rule) == 0) || (!deltas.empty() && deltas.count(record.delta) == 0))
+            continue;
+
+        ++matched;
+        string opcode = record.opcode < opcodeCount ? OPCODE_NAMES[record.opcode] : to_string(record.opcode);
+        string delta = record.delta < 0 ? "machine" : "delta_" + to_string(record.delta);
+        if (summary)
+        {
+            ++ruleCounts["Rule " + to_string(record.rule)];
+            ++opcodeCounts[opcode];
+            ++deltaCounts[delta];
+            maxDepth = max(maxDepth, record.stackDepth);
+        }
+        else
+        {
+            cout << steps << " rule=" << (int)record.rule << " op=" << opcode << " delta=" << delta << " stack=" << record.stackDepth
+                 << " env=" << record.environment << "\n";
+        }
+    }
+
+    if (trace.gcount() != 0)
+    {
+        cerr << "Truncated record after step " << steps << "\n";
+        return 1;
+    }
+
+    if (summary)
+    {
+        cout << steps << " steps, " << matched << " matched, maximum stack depth " << maxDepth << "\n";
+        printCounts("Rules", ruleCounts, matched);
+        printCounts("Opcodes", opcodeCounts, matched);
+        printCounts("Deltas", deltaCounts, matched);
+    }
+
+    return 0;
+}
+
+bool parseList(const string &str, set<long> &numbers)
+{
+    stringstream ss(str);
+    for (string item; getline(ss, item, ',');)
+    {
+        try
+        {
+            size_t end;
+            numbers.insert(stol(item, &end));
+            if (end != item.length())
+                return false;
+        }
+        catch (const exception &)
+        {
+            return false;
+        }
+    }
+    return !numbers.empty();
+}
+
+void printCounts(const string &title, const map<string, long> &counts, long total)
+{
+    vector<pair<long, string>> sorted;
+    for (const auto &count : counts)
+        sorted.push_back({-count.second, count.first});
+    sort(sorted.begin(), sorted.end());
+
+    cout << "\n"
+         << title << ":\n";
+    for (const auto &item : sorted)
+    {
+        cout << setw(10) << -item.first << setw(7) << fixed << setprecision(1) << 100.0 * -item.first / total << "%  " << item.second << "\n";
+    }
+}
@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include "trace.h"
+
+using namespace std;
+
+/**
+ * @brief Format the line of the new environment in the text trace
+ * @param index The index of the environment
+ * @return The line without the line break
+ */
+static string formatNewEnvironment(int index)
+{
+    ostringstream line;
+    line << setw(8) << "New Env"
+         << ": " << index;
+    return line.str();
+}
+
+/**
+ * @brief Format the line of the bindings in the text trace
+ * @param bindings The names and the bound values
+ * @return The line without the line break
+ */
+static string formatBindings(const vector<pair<string, shared_ptr<STNode>>> &bindings)
+{
+    ostringstream line;
+    line << setw(8) << "Bindings"
+         << ": ";
+    for (int i = 0; i < (int)bindings.size(); ++i)
+    {
+        line << "(" << bindings[i].first << " = " << bindings[i].second->toString() << ")" << (i == (int)bindings.size() - 1 ? "" : ", ");
+    }
+    return line.str();
+}
+
+string formatValue(const STNode &node)
+{
+    return node.getType() == "String" ? ("'" + node.toString() + "'") : node.toString();
+}
+
+TextTracer::TextTracer(string filename) : out(filename)
+{
+}
+
+void TextTracer::startStep(const MachineState &state)
+{
+    const vector<Instruction> &control = state.control;
+    out << setw(8) << "Control"
+        << ": ";
+    for (int i = 0; i < (int)control.size(); ++i)
+    {
+        out << state.program.toString(control[i]) << (i == (int)control.size() - 1 ? "\n" : " ");
+    }
+
+    out << setw(8) << "Stack"
+        << ": ";
+    for (int i = state.stack.size() - 1; i >= 0; --i)
+    {
+        out << formatValue(*state.stack[i]) << (i == 0 ? "\n" : " ");
+    }
+
+    out << setw(8) << "Next"
+        << ": " << state.program.toString(control.back()) << "\n";
+}
+
+void TextTracer::newEnvironment(int index)
+{
+    out << formatNewEnvironment(index) << "\n";
+}
+
+void TextTracer::bind(const vector<pair<string, shared_ptr<STNode>>> &bindings)
+{
+    out << formatBindings(bindings) << "\n";
+}
+
+void TextTracer::endStep(const MachineState &, int rule)
+{
+    out << setw(8) << "Rule"
+        << ": " << rule << "\n\n";
+}
+
+void TextTracer::flush()
+{
+    out.flush();
+}
+
+CompactTracer::CompactTracer(string filename, long interval) : out(filename)
+{
+    this->interval = interval;
+    this->controlSize = 0;
+    this->stackSize = 0;
+}
+
+void CompactTracer::startStep(const MachineState &state)
+{
+    controlSize = state.control.size();
+    stackSize = state.stack.size();
+
+    if ((state.step - 1) % interval == 0)
+    {
+        out << "K " << state.step << " " << controlSize << " " << stackSize << "\n";
+        for (size_t i = 0; i < controlSize; ++i)
+        {
+            out << "c " << state.program.toString(state.control[i]) << "\n";
+        }
+        for (size_t i = 0; i < stackSize; ++i)
+        {
+            out << "s " << formatValue(*state.stack[i]) << "\n";
+        }
+    }
+}
+
+void CompactTracer::newEnvironment(int index)
+{
+    out << "x " << formatNewEnvironment(index) << "\n";
+}
+
+void CompactTracer::bind(const vector<pair<string, shared_ptr<STNode>>> &bindings)
+{
+    out << "x " << formatBindings(bindings) << "\n";
+}
+
+void CompactTracer::endStep(const MachineState &state, int rule)
+{
+    // The items below the lowest size of the stack within the step are untouched
+    size_t low = state.stack.getLow();
+    if (low < stackSize)
+    {
+        out << "p " << stackSize - low << "\n";
+    }
+    for (size_t i = low; i < state.stack.size(); ++i)
+    {
+        out << "s " << formatValue(*state.stack[i]) << "\n";
+    }
+
+    // The control only loses the next instruction in a step
+    for (size_t i = controlSize - 1; i < state.control.size(); ++i)
+    {
+        out << "c " << state.program.toString(state.control[i]) << "\n";
+    }
+
+    out << "r " << rule << "\n";
+}
+
+void CompactTracer::flush()
+{
+    out.flush();
+}
+
+static_assert(sizeof(OPCODE_NAMES) / sizeof(OPCODE_NAMES[0]) == OP_BRANCH_INTEGER + 1, "every opcode needs a name");
+
+BinaryTracer::BinaryTracer(string filename) : out(filename, ios::binary)
+{
+    out.write(TRACE_HEADER, sizeof(TRACE_HEADER));
+    records.reserve(1 << 16);
+    current = {};
+}
+
+BinaryTracer::~BinaryTracer()
+{
+    writeOut();
+}
+
+void BinaryTracer::startStep(const MachineState &state)
+{
+    const Instruction &next = state.control.back();
+    current.opcode = next.opcode;
+    current.delta = state.delta;
+    current.stackDepth = state.stack.size();
+    current.environment = state.environment;
+}
+
+void BinaryTracer::newEnvironment(int)
+{
+}
+
+void BinaryTracer::bind(const vector<pair<string, shared_ptr<STNode>>> &)
+{
+}
+
+void BinaryTracer::endStep(const MachineState &, int rule)
+{
+    current.rule = rule;
+    records.push_back(current);
+    if (records.size() == records.capacity())
+    {
+        writeOut();
+    }
+}
+
+void BinaryTracer::flush()
+{
+    writeOut();
+    out.flush();
+}
+
+void BinaryTracer::writeOut()
+{
+    out.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(TraceRecord));
+    records.clear();
+}
+
+FlightRecorder::FlightRecorder(size_t capacity)
+{
+    size_t size = 1;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+
+    this->records.resize(size);
+    this->mask = size - 1;
+    this->last = 0;
+}
+
+void FlightRecorder::dump(ostream &os, const Program &program) const
+{
+    long first = max(1L, last - (long)records.size() + 1);
+    os << "Last " << last - first + 1 << " of " << last << " steps\n\n";
+    for (long step = first; step <= last; ++step)
+    {
+        const FlightRecord &record = records[step & mask];
+        os << setw(8) << "Step"
+           << ": " << record.step << "\n";
+        os << setw(8) << "Next"
+           << ": " << program.toString(record.instruction) << "\n";
+        os << setw(8) << "Stack"
+           << ": " << record.stackDepth << " items\n";
+        os << setw(8) << "Env"
+           << ": " << record.environment << "\n";
+        if (record.rule == 0)
+            os << setw(8) << "Rule"
+               << ": failed\n\n";
+        else
+            os << setw(8) << "Rule"
+               << ": " << record.rule << "\n\n";
+    }
+}
@@ -0,0 +1,199 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "machine.h"
+#include "st_types.h"
+#include "trace_format.h"
+
+/**
+ * @brief Format a value as it is shown on the stack in the execution traces
+ * @param node The value
+ * @return The value as a string; strings are quoted
+ */
+std::string formatValue(const STNode &node);
+
+class Tracer
+{
+public:
+    virtual ~Tracer() = default;
+
+    /**
+     * @brief Record the state before a step
+     * @param state The state of the machine; the next instruction is still on top of the control
+     */
+    virtual void startStep(const MachineState &state) = 0;
+
+    /**
+     * @brief Record the environment created by the step
+     * @param index The index of the environment
+     */
+    virtual void newEnvironment(int index) = 0;
+
+    /**
+     * @brief Record the bindings of the environment created by the step
+     * @param bindings The names and the bound values
+     */
+    virtual void bind(const std::vector<std::pair<std::string, std::shared_ptr<STNode>>> &bindings) = 0;
+
+    /**
+     * @brief Record the end of a step
+     * @param state The state of the machine after the step
+     * @param rule The CSE rule applied in the step
+     */
+    virtual void endStep(const MachineState &state, int rule) = 0;
+
+    /**
+     * @brief Write out everything recorded so far, so the trace is complete when the process exits without unwinding
+     */
+    virtual void flush() = 0;
+};
+
+// Writes the full control and stack on every step, as printed with -exe
+class TextTracer : public Tracer
+{
+public:
+    /**
+     * @brief Create a text trace
+     * @param filename The name of the trace file
+     */
+    TextTracer(std::string filename);
+
+    void startStep(const MachineState &state) override;
+    void newEnvironment(int index) override;
+    void bind(const std::vector<std::pair<std::string, std::shared_ptr<STNode>>> &bindings) override;
+    void endStep(const MachineState &state, int rule) override;
+    void flush() override;
+
+private:
+    std::ofstream out;
+};
+
+/**
+ * Writes the items each step pushes and pops, with a full snapshot of the control and the stack at intervals.
+ * Each line starts with a tag:
+ *   K step n m   a snapshot before the step; the next n lines are the control and the m lines after them the stack,
+ *                both from the bottom, each as "c item" or "s item"
+ *   x line       a line printed within the step in the text trace
+ *   p n          the step popped n items from the stack
+ *   s item       the step pushed an item to the stack
+ *   c item       the step pushed an item to the control; every step also pops the next item from the control
+ *   r rule       the end of the step
+ */
+class CompactTracer : public Tracer
+{
+public:
+    /**
+     * @brief Create a compact trace
+     * @param filename The name of the trace file
+     * @param interval The number of steps between snapshots
+     */
+    CompactTracer(std::string filename, long interval);
+
+    void startStep(const MachineState &state) override;
+    void newEnvironment(int index) override;
+    void bind(const std::vector<std::pair<std::string, std::shared_ptr<STNode>>> &bindings) override;
+    void endStep(const MachineState &state, int rule) override;
+    void flush() override;
+
+private:
+    std::ofstream out;
+    long interval;
+    std::size_t controlSize; // size of the control before the step
+    std::size_t stackSize;   // size of the stack before the step
+};
+
+// Writes a fixed-size record of each step in the binary format of trace_format.h
+class BinaryTracer : public Tracer
+{
+public:
+    /**
+     * @brief Create a binary trace
+     * @param filename The name of the trace file
+     */
+    BinaryTracer(std::string filename);
+    ~BinaryTracer();
+
+    void startStep(const MachineState &state) override;
+    void newEnvironment(int index) override;
+    void bind(const std::vector<std::pair<std::string, std::shared_ptr<STNode>>> &bindings) override;
+    void endStep(const MachineState &state, int rule) override;
+    void flush() override;
+
+private:
+    std::ofstream out;
+    std::vector<TraceRecord> records; // records not written yet
+    TraceRecord current;              // record of the current step
+
+    /**
+     * @brief Write the buffered records to the file
+     */
+    void writeOut();
+};
+
+// A step kept by the flight recorder
+struct FlightRecord
+{
+    long step;
+    Instruction instruction;
+    uint32_t stackDepth; // size of the stack before the step
+    int32_t environment; // index of the current environment before the step
+    int32_t rule;        // CSE rule applied in the step, 0 if the step did not finish
+};
+
+/**
+ * Keeps the last steps of the machine in a ring buffer, so there is some context when the execution fails. Recording a
+ * step only copies a few words; the records are formatted when they are dumped.
+ */
+class FlightRecorder
+{
+public:
+    /**
+     * @brief Create a flight recorder
+     * @param capacity The number of steps to keep; rounded up to a power of two
+     */
+    FlightRecorder(std::size_t capacity = 1024);
+
+    /**
+     * @brief Record a step before it is executed
+     * @param step The number of the step
+     * @param instruction The executed instruction
+     * @param stackDepth The size of the stack
+     * @param environment The index of the current environment
+     */
+    void startStep(long step, const Instruction &instruction, std::size_t stackDepth, int environment)
+    {
+        records[step & mask] = {step, instruction, (uint32_t)stackDepth, environment, 0};
+        last = step;
+    }
+
+    /**
+     * @brief Record the rule applied in the step recorded last
+     * @param rule The CSE rule
+     */
+    void endStep(int rule)
+    {
+        records[last & mask].rule = rule;
+    }
+
+    /**
+     * @brief Write the recorded steps, the oldest first
+     * @param os The output stream to write to
+     * @param program The program the instructions belong to
+     */
+    void dump(std::ostream &os, const Program &program) const;
+
+private:
+    std::vector<FlightRecord> records;
+    std::size_t mask; // records.size() - 1
+    long last;        // number of the last recorded step, 0 if none
+};
+
+#endif // TRACE_H
@@ -0,0 +1,40 @@
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+#include <cstdint>
+
+// Format of the binary execution trace written with -exe-bin, shared with the tools that read it
+
+// The file starts with these bytes and is followed by one record per step
+const char TRACE_HEADER[8] = {'R', 'P', 'A', 'L', 'T', 'R', '\0', '\x01'};
+
+struct TraceRecord
+{
+    uint8_t rule;        // CSE rule applied in the step
+    uint8_t opcode;      // opcode of the executed instruction
+    uint16_t reserved;   // always 0
+    int32_t delta;       // index of the delta of the instruction, -1 if the instruction was placed by the machine
+    uint32_t stackDepth; // size of the stack before the step
+    int32_t environment; // index of the current environment before the step
+};
+
+static_assert(sizeof(TraceRecord) == 16, "trace records are written as they are laid out in memory");
+
+// Names of the opcodes in the order of their values
+const char *const OPCODE_NAMES[] = {
+    "identifier",
+    "constant",
+    "tuple",
+    "lambda",
+    "gamma",
+    "binary",
+    "unary",
+    "beta",
+    "tau",
+    "environment",
+    "apply_identifiers",
+    "operate_integer",
+    "branch_integer",
+};
+
+#endif // TRACE_FORMAT_H
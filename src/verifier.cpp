@@ -0,0 +1,150 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "st.h"
+
+using namespace std;
+
+bool ST::verify(const vector<shared_ptr<STNode>> &controlStructure, int deltaCount) const
+{
+    // The control structure is executed from the back; track how many values it has put on the stack so far
+    int depth = 0;
+    for (int i = controlStructure.size() - 1; i >= 0; --i)
+    {
+        shared_ptr<STNode> node = controlStructure[i];
+        string nodeType = node->getType();
+
+        if (nodeType == "Identifier" || nodeType == "Integer" || nodeType == "String" || nodeType == "TruthValue" ||
+            nodeType == "Tuple" || nodeType == "Dummy" || nodeType == "YStar")
+        {
+            // CSE Rule 1
+            ++depth;
+        }
+        else if (nodeType == "Lambda")
+        {
+            // CSE Rule 2
+            int index = static_pointer_cast<Lambda>(node)->getIndex();
+            if (index <= 0 || index >= deltaCount)
+                return false;
+            ++depth;
+        }
+        else if (nodeType == "Gamma" || nodeType == "BinaryOperator")
+        {
+            // CSE Rules 3, 4, 10, 11, 12, 13 and CSE Rule 6 replace rator and rand by a single value
+            // Rule 4 and Rule 11 enter a verified delta between two environment markers, which leaves a single value as well
+            if (depth < 2)
+                return false;
+            --depth;
+        }
+        else if (nodeType == "UnaryOperator")
+        {
+            // CSE Rule 7
+            if (depth < 1)
+                return false;
+        }
+        else if (nodeType == "Beta")
+        {
+            // CSE Rule 8 replaces the truth value by the value of a verified delta
+            shared_ptr<Beta> beta = static_pointer_cast<Beta>(node);
+            if (depth < 1)
+                return false;
+            if (beta->getThenIndex() <= 0 || beta->getThenIndex() >= deltaCount || beta->getElseIndex() <= 0 || beta->getElseIndex() >= deltaCount)
+                return false;
+        }
+        else if (nodeType == "Superinstruction")
+        {
+            // Each superinstruction puts the value of the sequence it fuses on the stack
+            shared_ptr<Superinstruction> s = static_pointer_cast<Superinstruction>(node);
+            if (s->getKind() == BRANCH_INTEGER)
+            {
+                shared_ptr<Beta> beta = static_pointer_cast<Beta>(s->getNode(0));
+                if (beta->getThenIndex() <= 0 || beta->getThenIndex() >= deltaCount || beta->getElseIndex() <= 0 || beta->getElseIndex() >= deltaCount)
+                    return false;
+            }
+            ++depth;
+        }
+        else if (nodeType == "Tau")
+        {
+            // CSE Rule 9
+            int n = static_pointer_cast<Tau>(node)->getSize();
+            if (depth < n)
+                return false;
+            depth = depth - n + 1;
+        }
+        else
+        {
+            // Environment markers are only placed by the machine; any other node is not executable
+            return false;
+        }
+    }
+
+    return depth == 1;
+}
+
+bool ST::verify(int index) const
+{
+    int deltaCount = program.getDeltaCount();
+    const Instruction *code = program.getCode(index);
+    int depth = 0;
+    for (int i = program.getSize(index) - 1; i >= 0; --i)
+    {
+        const Instruction &instruction = code[i];
+        switch (instruction.opcode)
+        {
+        case OP_IDENTIFIER:
+        case OP_CONSTANT:
+        case OP_TUPLE:
+        case OP_APPLY_IDENTIFIERS:
+        case OP_OPERATE_INTEGER:
+            // CSE Rule 1; each superinstruction puts the value of the sequence it fuses on the stack
+            ++depth;
+            break;
+        case OP_LAMBDA:
+        {
+            // CSE Rule 2
+            int delta = static_pointer_cast<Lambda>(program.getConstant(instruction.a))->getIndex();
+            if (delta <= 0 || delta >= deltaCount)
+                return false;
+            ++depth;
+            break;
+        }
+        case OP_BRANCH_INTEGER:
+            // delta_else follows delta_then
+            if (instruction.c <= 0 || instruction.c + 1 >= deltaCount)
+                return false;
+            ++depth;
+            break;
+        case OP_GAMMA:
+        case OP_BINARY:
+            // CSE Rules 3, 4, 10, 11, 12, 13 and CSE Rule 6
+            if (depth < 2)
+                return false;
+            --depth;
+            break;
+        case OP_UNARY:
+            // CSE Rule 7
+            if (depth < 1)
+                return false;
+            break;
+        case OP_BETA:
+            // CSE Rule 8
+            if (depth < 1)
+                return false;
+            if (instruction.a <= 0 || instruction.a >= deltaCount || instruction.b <= 0 || instruction.b >= deltaCount)
+                return false;
+            break;
+        case OP_TAU:
+            // CSE Rule 9
+            if (depth < instruction.a)
+                return false;
+            depth = depth - instruction.a + 1;
+            break;
+        default:
+            // Environment markers are only placed by the machine
+            return false;
+        }
+    }
+
+    return depth == 1;
+}